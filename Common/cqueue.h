@@ -0,0 +1,389 @@
+#ifndef CQUEUE_H
+#define CQUEUE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Concurrent FIFO queue of pointers shared by the simulators. It
+|* builds as C or C++ (atomics use the GCC __atomic builtins) and
+|* offers interchangeable backends behind one API:
+|*
+|*   CQUEUE_MUTEX    circular array under one mutex
+|*   CQUEUE_RING     bounded lock-free ring (multi-producer/multi-consumer)
+|*   CQUEUE_TWO_LOCK Michael-Scott linked queue with separate head and tail locks
+|*
+|* Every backend supports non-blocking, blocking and batch pops.
+|* Blocking pops sleep on a condition variable that pushers only
+|* signal when a popper is actually waiting. */
+
+#define CQUEUE_CACHE_LINE 64 /* Size of a cache line, used to pad shared state */
+
+enum CQueueBackend {
+    CQUEUE_MUTEX,
+    CQUEUE_RING,
+    CQUEUE_TWO_LOCK
+};
+
+/* Cell of the lock-free ring. The sequence number tells pushers and
+|* poppers whether the cell is free or full for their lap. */
+struct CQueueCell {
+    size_t seq;
+    void *x;
+} __attribute__((aligned(CQUEUE_CACHE_LINE)));
+
+/* Node of the two-lock queue */
+struct CQueueNode {
+    void *x;
+    struct CQueueNode *next;
+};
+
+struct CQueue {
+    enum CQueueBackend backend;
+    size_t capacity; /* Most items held at once, 0 for no bound (ring is always bounded) */
+
+    /* CQUEUE_RING */
+    size_t pushPos __attribute__((aligned(CQUEUE_CACHE_LINE))); /* Next position to push to */
+    size_t popPos __attribute__((aligned(CQUEUE_CACHE_LINE))); /* Next position to pop from */
+    size_t mask __attribute__((aligned(CQUEUE_CACHE_LINE))); /* Ring capacity - 1 */
+    struct CQueueCell *cells;
+
+    /* CQUEUE_MUTEX */
+    pthread_mutex_t lock;
+    void **items; /* Circular array of items */
+    size_t first; /* Index of the oldest item */
+    size_t slots; /* Length of items */
+
+    /* CQUEUE_TWO_LOCK */
+    pthread_mutex_t headLock __attribute__((aligned(CQUEUE_CACHE_LINE))); /* Mutex for poppers */
+    struct CQueueNode *head; /* Dummy node, the oldest item is head->next */
+    pthread_mutex_t tailLock __attribute__((aligned(CQUEUE_CACHE_LINE))); /* Mutex for pushers */
+    struct CQueueNode *tail;
+
+    /* Shared by every backend */
+    size_t size __attribute__((aligned(CQUEUE_CACHE_LINE))); /* Number of items (ring derives it from the positions) */
+    int waiters; /* Poppers sleeping in cqueuePop() */
+    int closed; /* Set by cqueueClose() */
+    pthread_mutex_t waitLock; /* Mutex for sleeping poppers */
+    pthread_cond_t waitCond; /* Signaled when an item is pushed or the queue is closed */
+};
+
+/* Returns the name of a backend */
+static inline const char *cqueueBackendName(enum CQueueBackend backend) {
+    switch(backend) {
+    case CQUEUE_MUTEX:
+        return "mutex";
+    case CQUEUE_RING:
+        return "ring";
+    case CQUEUE_TWO_LOCK:
+        return "two-lock";
+    }
+    return "unknown";
+}
+
+/* Parses a backend name. Returns 0 on success, -1 if the name is unknown. */
+static inline int cqueueParseBackend(const char *name, enum CQueueBackend *backend) {
+    if(strcmp(name, "mutex") == 0)
+        *backend = CQUEUE_MUTEX;
+    else if(strcmp(name, "ring") == 0)
+        *backend = CQUEUE_RING;
+    else if(strcmp(name, "two-lock") == 0)
+        *backend = CQUEUE_TWO_LOCK;
+    else
+        return -1;
+    return 0;
+}
+
+/* Creates a queue. capacity bounds the number of items held at
+|* once (0 for no bound). The ring needs a bound and rounds it up
+|* to a power of two. Returns NULL on failure. */
+static inline struct CQueue *cqueueCreate(enum CQueueBackend backend, size_t capacity) {
+    if(backend == CQUEUE_RING && capacity == 0)
+        return NULL;
+
+    struct CQueue *q = (struct CQueue *) aligned_alloc(CQUEUE_CACHE_LINE, sizeof(struct CQueue));
+    if(q == NULL)
+        return NULL;
+    memset(q, 0, sizeof(struct CQueue));
+    q->backend = backend;
+    q->capacity = capacity;
+    pthread_mutex_init(&q->waitLock, NULL);
+    pthread_cond_init(&q->waitCond, NULL);
+
+    switch(backend) {
+    case CQUEUE_RING: {
+        size_t slots = 2;
+        while(slots < capacity)
+            slots <<= 1;
+        q->cells = (struct CQueueCell *) aligned_alloc(CQUEUE_CACHE_LINE, sizeof(struct CQueueCell) * slots);
+        for(size_t i = 0; i < slots; i++) {
+            q->cells[i].seq = i;
+        }
+        q->mask = slots - 1;
+        q->capacity = slots;
+        break;
+    }
+    case CQUEUE_MUTEX:
+        pthread_mutex_init(&q->lock, NULL);
+        q->slots = capacity > 0 ? capacity : 16;
+        q->items = (void **) malloc(sizeof(void *) * q->slots);
+        break;
+    case CQUEUE_TWO_LOCK:
+        pthread_mutex_init(&q->headLock, NULL);
+        pthread_mutex_init(&q->tailLock, NULL);
+        q->head = q->tail = (struct CQueueNode *) calloc(1, sizeof(struct CQueueNode));
+        break;
+    }
+    return q;
+}
+
+/* Frees the queue. No other thread may be using it. */
+static inline void cqueueDestroy(struct CQueue *q) {
+    free(q->cells);
+    free(q->items);
+    struct CQueueNode *node = q->head;
+    while(node != NULL) {
+        struct CQueueNode *next = node->next;
+        free(node);
+        node = next;
+    }
+    free(q);
+}
+
+/* Returns the number of items in the queue. Only a snapshot,
+|* since other threads may push or pop meanwhile. */
+static inline size_t cqueueSize(struct CQueue *q) {
+    if(q->backend == CQUEUE_RING) {
+        size_t popPos = __atomic_load_n(&q->popPos, __ATOMIC_RELAXED);
+        size_t pushPos = __atomic_load_n(&q->pushPos, __ATOMIC_RELAXED);
+        return pushPos > popPos ? pushPos - popPos : 0;
+    }
+    return __atomic_load_n(&q->size, __ATOMIC_RELAXED);
+}
+
+/* Reserves room for one item against the capacity. Returns 0 on success, -1 if full. */
+static inline int cqueueReserve(struct CQueue *q) {
+    if(q->capacity == 0) {
+        __atomic_fetch_add(&q->size, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if(__atomic_fetch_add(&q->size, 1, __ATOMIC_RELAXED) >= q->capacity) {
+        __atomic_fetch_sub(&q->size, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    return 0;
+}
+
+/* Wakes a sleeping popper, if there is one, after an item is pushed */
+static inline void cqueueWake(struct CQueue *q) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&q->waiters, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&q->waitLock);
+        pthread_cond_signal(&q->waitCond);
+        pthread_mutex_unlock(&q->waitLock);
+    }
+}
+
+/* Pushes x to the ring. Returns 0 on success, -1 if the ring is full. */
+static inline int cqueueRingPush(struct CQueue *q, void *x) {
+    size_t pos = __atomic_load_n(&q->pushPos, __ATOMIC_RELAXED);
+    for(;;) {
+        struct CQueueCell *cell = &q->cells[pos & q->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        long diff = (long) seq - (long) pos;
+        if(diff == 0) { /* Cell is free for this lap, try to claim it */
+            if(__atomic_compare_exchange_n(&q->pushPos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cell->x = x;
+                __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+                return 0;
+            }
+        } else if(diff < 0) { /* Cell still holds an item from the last lap */
+            return -1;
+        } else {
+            pos = __atomic_load_n(&q->pushPos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Pops the oldest item of the ring into *x. Returns 1 on success, 0 if the ring is empty. */
+static inline int cqueueRingPop(struct CQueue *q, void **x) {
+    size_t pos = __atomic_load_n(&q->popPos, __ATOMIC_RELAXED);
+    for(;;) {
+        struct CQueueCell *cell = &q->cells[pos & q->mask];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        long diff = (long) seq - (long) (pos + 1);
+        if(diff == 0) { /* Cell is full for this lap, try to claim it */
+            if(__atomic_compare_exchange_n(&q->popPos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *x = cell->x;
+                __atomic_store_n(&cell->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if(diff < 0) { /* Nothing pushed here yet */
+            return 0;
+        } else {
+            pos = __atomic_load_n(&q->popPos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Pushes x to the queue. Returns 0 on success, -1 if the queue is full. */
+static inline int cqueuePush(struct CQueue *q, void *x) {
+    switch(q->backend) {
+    case CQUEUE_RING:
+        if(cqueueRingPush(q, x) != 0)
+            return -1;
+        break;
+    case CQUEUE_MUTEX:
+        pthread_mutex_lock(&q->lock);
+        if(q->capacity > 0 && q->size == q->capacity) {
+            pthread_mutex_unlock(&q->lock);
+            return -1;
+        }
+        if(q->size == q->slots) { /* Grow, unwrapping the items into the new array */
+            void **items = (void **) malloc(sizeof(void *) * q->slots * 2);
+            for(size_t i = 0; i < q->size; i++) {
+                items[i] = q->items[(q->first + i) % q->slots];
+            }
+            free(q->items);
+            q->items = items;
+            q->first = 0;
+            q->slots *= 2;
+        }
+        q->items[(q->first + q->size) % q->slots] = x;
+        __atomic_store_n(&q->size, q->size + 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&q->lock);
+        break;
+    case CQUEUE_TWO_LOCK: {
+        if(cqueueReserve(q) != 0)
+            return -1;
+        struct CQueueNode *node = (struct CQueueNode *) malloc(sizeof(struct CQueueNode));
+        node->x = x;
+        node->next = NULL;
+        pthread_mutex_lock(&q->tailLock);
+        __atomic_store_n(&q->tail->next, node, __ATOMIC_RELEASE);
+        q->tail = node;
+        pthread_mutex_unlock(&q->tailLock);
+        break;
+    }
+    }
+    cqueueWake(q);
+    return 0;
+}
+
+/* Pops up to max of the oldest items into xs without blocking.
+|* The mutex and two-lock backends take their lock once for the
+|* whole batch. Returns the number of items popped. */
+static inline int cqueuePopBatch(struct CQueue *q, void **xs, int max) {
+    int count = 0;
+    switch(q->backend) {
+    case CQUEUE_RING:
+        while(count < max && cqueueRingPop(q, &xs[count]))
+            count++;
+        break;
+    case CQUEUE_MUTEX:
+        pthread_mutex_lock(&q->lock);
+        while(count < max && q->size > 0) {
+            xs[count++] = q->items[q->first];
+            q->first = (q->first + 1) % q->slots;
+            __atomic_store_n(&q->size, q->size - 1, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&q->lock);
+        break;
+    case CQUEUE_TWO_LOCK:
+        pthread_mutex_lock(&q->headLock);
+        while(count < max) {
+            struct CQueueNode *dummy = q->head;
+            struct CQueueNode *next = __atomic_load_n(&dummy->next, __ATOMIC_ACQUIRE);
+            if(next == NULL)
+                break;
+            xs[count++] = next->x;
+            q->head = next; /* next becomes the new dummy node */
+            free(dummy);
+        }
+        pthread_mutex_unlock(&q->headLock);
+        if(count > 0)
+            __atomic_fetch_sub(&q->size, count, __ATOMIC_RELAXED);
+        break;
+    }
+    return count;
+}
+
+/* Pops the oldest item into *x without blocking. Returns 1 on success, 0 if the queue is empty. */
+static inline int cqueueTryPop(struct CQueue *q, void **x) {
+    if(q->backend == CQUEUE_RING)
+        return cqueueRingPop(q, x);
+    return cqueuePopBatch(q, x, 1);
+}
+
+/* Pops the oldest item into *x, sleeping while the queue is
+|* empty. Returns 1 on success, 0 once the queue is closed and empty. */
+static inline int cqueuePop(struct CQueue *q, void **x) {
+    for(;;) {
+        if(cqueueTryPop(q, x))
+            return 1;
+        pthread_mutex_lock(&q->waitLock);
+        __atomic_fetch_add(&q->waiters, 1, __ATOMIC_SEQ_CST);
+        int found = cqueueTryPop(q, x); /* Check again now that pushers will see the waiter */
+        if(!found && !q->closed)
+            pthread_cond_wait(&q->waitCond, &q->waitLock);
+        __atomic_fetch_sub(&q->waiters, 1, __ATOMIC_RELAXED);
+        int closed = q->closed;
+        pthread_mutex_unlock(&q->waitLock);
+        if(found)
+            return 1;
+        if(closed)
+            return cqueueTryPop(q, x);
+    }
+}
+
+/* Closes the queue and wakes every sleeping popper. Items already
+|* in the queue can still be popped. */
+static inline void cqueueClose(struct CQueue *q) {
+    pthread_mutex_lock(&q->waitLock);
+    q->closed = 1;
+    pthread_cond_broadcast(&q->waitCond);
+    pthread_mutex_unlock(&q->waitLock);
+}
+
+/* Copies up to max items into buf, oldest first, and returns how
+|* many were copied. The ring is copied without blocking anyone:
+|* a cell is only kept if its sequence number is the same before
+|* and after it is read, so items popped meanwhile are skipped. */
+static inline size_t cqueueSnapshot(struct CQueue *q, void **buf, size_t max) {
+    size_t count = 0;
+    switch(q->backend) {
+    case CQUEUE_RING: {
+        size_t popPos = __atomic_load_n(&q->popPos, __ATOMIC_ACQUIRE);
+        size_t pushPos = __atomic_load_n(&q->pushPos, __ATOMIC_ACQUIRE);
+        for(size_t pos = popPos; pos < pushPos && count < max; pos++) {
+            struct CQueueCell *cell = &q->cells[pos & q->mask];
+            if(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1)
+                continue;
+            void *x = cell->x;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if(__atomic_load_n(&cell->seq, __ATOMIC_RELAXED) == pos + 1)
+                buf[count++] = x;
+        }
+        break;
+    }
+    case CQUEUE_MUTEX:
+        pthread_mutex_lock(&q->lock);
+        for(; count < q->size && count < max; count++) {
+            buf[count] = q->items[(q->first + count) % q->slots];
+        }
+        pthread_mutex_unlock(&q->lock);
+        break;
+    case CQUEUE_TWO_LOCK:
+        pthread_mutex_lock(&q->headLock);
+        for(struct CQueueNode *node = __atomic_load_n(&q->head->next, __ATOMIC_ACQUIRE);
+            node != NULL && count < max; node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) {
+            buf[count++] = node->x;
+        }
+        pthread_mutex_unlock(&q->headLock);
+        break;
+    }
+    return count;
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cqueue.h"
+
+/* Benchmark for the cqueue backends. Producers push items while
+|* consumers pop them in batches, and every backend is run on the
+|* same workload.
+|*
+|* Usage: cqueue_bench [producers] [consumers] [items per producer] [batch] */
+
+int producers = 2; /* Number of producer threads */
+int consumers = 2; /* Number of consumer threads */
+long items = 1000000; /* Items pushed by each producer */
+int batch = 16; /* Most items popped at once */
+struct CQueue* q; /* Queue under test */
+
+/* Returns the current monotonic time in seconds */
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Thread method (producers). Pushes items, yielding while the queue is full. */
+void *producer(void *param) {
+    (void) param;
+    for(long i = 1; i <= items; i++) {
+        while(cqueuePush(q, (void *) (intptr_t) i) != 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+/* Thread method (consumers). Pops until the queue is closed and empty, returns the sum popped. */
+void *consumer(void *param) {
+    void *xs[batch];
+    long *sum = (long *) param;
+    for(;;) {
+        int count = cqueuePopBatch(q, xs, batch);
+        if(count == 0) { /* Sleep for the next item */
+            if(!cqueuePop(q, xs))
+                break;
+            count = 1;
+        }
+        for(int i = 0; i < count; i++)
+            *sum += (intptr_t) xs[i];
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc > 1)
+        producers = atoi(argv[1]);
+    if(argc > 2)
+        consumers = atoi(argv[2]);
+    if(argc > 3)
+        items = atol(argv[3]);
+    if(argc > 4)
+        batch = atoi(argv[4]);
+    if(producers < 1 || consumers < 1 || items < 1 || batch < 1) {
+        printf("ERROR: Arguments must be positive integers.\n\n");
+        return -1;
+    }
+
+    printf("Producers : %d | Consumers : %d | Items : %ld | Batch : %d\n\n", producers, consumers, items * producers, batch);
+    printf("%-10s %10s %14s\n", "Backend", "Seconds", "Items/s");
+
+    enum CQueueBackend backends[] = {CQUEUE_MUTEX, CQUEUE_RING, CQUEUE_TWO_LOCK};
+    for(int b = 0; b < 3; b++) {
+        q = cqueueCreate(backends[b], 1024);
+        pthread_t tid[producers + consumers];
+        long sums[consumers];
+        double started = now();
+        for(int i = 0; i < consumers; i++) {
+            sums[i] = 0;
+            pthread_create(&tid[producers + i], NULL, consumer, &sums[i]);
+        }
+        for(int i = 0; i < producers; i++) {
+            pthread_create(&tid[i], NULL, producer, NULL);
+        }
+        for(int i = 0; i < producers; i++) {
+            pthread_join(tid[i], NULL);
+        }
+        cqueueClose(q);
+        long sum = 0;
+        for(int i = 0; i < consumers; i++) {
+            pthread_join(tid[producers + i], NULL);
+            sum += sums[i];
+        }
+        double elapsed = now() - started;
+
+        /* Every item must be popped exactly once */
+        if(sum != producers * (items * (items + 1) / 2)) {
+            printf("ERROR: %s backend lost or duplicated items\n", cqueueBackendName(backends[b]));
+            return -1;
+        }
+        printf("%-10s %10.3f %14.0f\n", cqueueBackendName(backends[b]), elapsed, items * producers / elapsed);
+        cqueueDestroy(q);
+    }
+}
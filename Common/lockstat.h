@@ -0,0 +1,183 @@
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Instrumented mutex shared by the simulators. Builds as C or C++.
+|* Each named lock counts its acquisitions and contended
+|* acquisitions (the first trylock failed), and keeps histograms of
+|* how long threads waited for it and how long they held it. The
+|* counters are only updated by the thread holding the lock, so the
+|* instrumentation itself takes no extra locks or atomics.
+|*
+|* Every lock registered with lockstatInit() is reported on stderr at
+|* exit, and on demand once lockstatEnableSignal() has been called. */
+
+#define LOCKSTAT_BUCKETS 40 /* Histogram bucket i counts times in [2^i, 2^(i+1)) ns */
+
+struct LockStat {
+    pthread_mutex_t lock;
+    const char *name; /* Name shown in the report */
+    long acquisitions; /* Times the lock was taken */
+    long contended; /* Times the lock was already held when asked for */
+    long long waitNs; /* Total time spent waiting for the lock */
+    long long holdNs; /* Total time the lock was held */
+    long waitHist[LOCKSTAT_BUCKETS]; /* Histogram of waits */
+    long holdHist[LOCKSTAT_BUCKETS]; /* Histogram of holds */
+    long long acquiredAt; /* Time the current holder took the lock */
+    struct LockStat *next; /* Next registered lock */
+};
+
+static struct LockStat *lockstatList = NULL; /* Every registered lock */
+static pthread_mutex_t lockstatListLock = PTHREAD_MUTEX_INITIALIZER; /* Mutex for lockstatList */
+static volatile sig_atomic_t lockstatRequested = 0; /* Set by the report signal */
+
+/* Returns the current monotonic time in nanoseconds */
+static inline long long lockstatNow() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/* Returns the histogram bucket for a time in nanoseconds */
+static inline int lockstatBucket(long long ns) {
+    int bucket = 0;
+    while(ns > 1 && bucket < LOCKSTAT_BUCKETS - 1) {
+        ns >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/* Prints the statistics of one lock */
+static inline void lockstatReport(struct LockStat *l, FILE *out) {
+    fprintf(out, "%s: %ld acquisitions, %ld contended (%.1f%%), avg wait %.0f ns, avg hold %.0f ns\n",
+            l->name, l->acquisitions, l->contended,
+            l->acquisitions ? 100.0 * l->contended / l->acquisitions : 0.0,
+            l->acquisitions ? (double) l->waitNs / l->acquisitions : 0.0,
+            l->acquisitions ? (double) l->holdNs / l->acquisitions : 0.0);
+    if(l->acquisitions == 0)
+        return;
+    fprintf(out, "    %-22s %10s %10s\n", "ns", "wait", "hold");
+    for(int i = 0; i < LOCKSTAT_BUCKETS; i++) {
+        if(l->waitHist[i] == 0 && l->holdHist[i] == 0)
+            continue;
+        char range[32];
+        snprintf(range, sizeof(range), "[%lld, %lld)", i == 0 ? 0LL : 1LL << i, 1LL << (i + 1));
+        fprintf(out, "    %-22s %10ld %10ld\n", range, l->waitHist[i], l->holdHist[i]);
+    }
+}
+
+/* Prints the statistics of every registered lock. The counters are
+|* read without taking the locks, so a report made while threads
+|* are running is only approximate. */
+static inline void lockstatReportAll() {
+    pthread_mutex_lock(&lockstatListLock);
+    flockfile(stderr);
+    fprintf(stderr, "\n---- Lock Statistics ----\n\n");
+    for(struct LockStat *l = lockstatList; l != NULL; l = l->next) {
+        lockstatReport(l, stderr);
+    }
+    fprintf(stderr, "\n");
+    funlockfile(stderr);
+    pthread_mutex_unlock(&lockstatListLock);
+}
+
+/* Initializes and registers a named lock. The first lock registered
+|* schedules the report at exit. Returns 0 on success. */
+static inline int lockstatInit(struct LockStat *l, const char *name) {
+    int result = pthread_mutex_init(&l->lock, NULL);
+    if(result != 0)
+        return result;
+    l->name = name;
+    l->acquisitions = l->contended = 0;
+    l->waitNs = l->holdNs = 0;
+    for(int i = 0; i < LOCKSTAT_BUCKETS; i++) {
+        l->waitHist[i] = l->holdHist[i] = 0;
+    }
+    pthread_mutex_lock(&lockstatListLock);
+    if(lockstatList == NULL)
+        atexit(lockstatReportAll);
+    l->next = lockstatList;
+    lockstatList = l;
+    pthread_mutex_unlock(&lockstatListLock);
+    return 0;
+}
+
+/* Unregisters the lock, reporting it first, and destroys it. For
+|* locks that do not live until exit. */
+static inline void lockstatDestroy(struct LockStat *l) {
+    pthread_mutex_lock(&lockstatListLock);
+    for(struct LockStat **link = &lockstatList; *link != NULL; link = &(*link)->next) {
+        if(*link == l) {
+            *link = l->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lockstatListLock);
+    lockstatReport(l, stderr);
+    pthread_mutex_destroy(&l->lock);
+}
+
+/* Handler for the report signal. Only sets a flag, the next unlock does the report. */
+static inline void lockstatSignal(int sig) {
+    (void) sig;
+    lockstatRequested = 1;
+}
+
+/* Reports every lock when the process receives sig */
+static inline void lockstatEnableSignal(int sig) {
+    signal(sig, lockstatSignal);
+}
+
+/* Records that the calling thread now holds the lock */
+static inline void lockstatAcquired(struct LockStat *l, long long waited) {
+    l->acquiredAt = lockstatNow();
+    l->acquisitions++;
+    l->waitNs += waited;
+    l->waitHist[lockstatBucket(waited)]++;
+}
+
+/* Records that the calling thread is about to give up the lock */
+static inline void lockstatReleasing(struct LockStat *l) {
+    long long held = lockstatNow() - l->acquiredAt;
+    l->holdNs += held;
+    l->holdHist[lockstatBucket(held)]++;
+}
+
+/* Takes the lock, counting it as contended if it was already held */
+static inline void lockstatLock(struct LockStat *l) {
+    if(pthread_mutex_trylock(&l->lock) == 0) {
+        lockstatAcquired(l, 0);
+        return;
+    }
+    long long asked = lockstatNow();
+    pthread_mutex_lock(&l->lock);
+    l->contended++;
+    lockstatAcquired(l, lockstatNow() - asked);
+}
+
+/* Releases the lock, then makes a report if one was requested */
+static inline void lockstatUnlock(struct LockStat *l) {
+    lockstatReleasing(l);
+    pthread_mutex_unlock(&l->lock);
+    if(lockstatRequested) {
+        lockstatRequested = 0;
+        lockstatReportAll();
+    }
+}
+
+/* Waits on cond with the lock held, like pthread_cond_wait(). The
+|* time asleep is neither a hold nor a wait: the hold ends when the
+|* thread goes to sleep and a new one starts when it wakes up. */
+static inline void lockstatCondWait(pthread_cond_t *cond, struct LockStat *l) {
+    lockstatReleasing(l);
+    pthread_cond_wait(cond, &l->lock);
+    lockstatAcquired(l, 0);
+}
+
+#endif
@@ -3,13 +3,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "node_pool.h"
+#include "../Common/lockstat.h"
 
-/* Implementing queue as linked list */
-struct Node {
-    int x;
-    struct Node* next;
-    struct Node* prev;
-};
+/* Implementing queue as linked list of pooled nodes */
 struct Queue {
     int size;
     struct Node* head;
@@ -21,7 +18,7 @@ int T; /* Number of objects */
 int threads = 0; /* Number of threads running */
 int *scores; /* Array of scores for each thread */
 struct Queue* q; /* FIFO queue */
-pthread_mutex_t queueLock; /* Mutex for FIFO queue */
+struct LockStat queueLock; /* Mutex for FIFO queue */
 
 
 int game = 0; /* Count of players still playing the game
@@ -29,7 +26,7 @@ int game = 0; /* Count of players still playing the game
               |* the game does not end until the dealer
               |* has stopped generating numbers and all
               |* players have emptied their hands. */
-pthread_mutex_t gameLock; /* Mutex for player count */
+struct LockStat gameLock; /* Mutex for player count */
 
 /* Prints the FIFO queue from last in to first in */
 void printQueue() {
@@ -47,7 +44,7 @@ void printQueue() {
 |* is nonzero. */
 void push(int x, int print) {
     struct Node* next = q->head;
-    struct Node* head = malloc(sizeof(struct Node));
+    struct Node* head = nodeAlloc();
     head->x = x;
     head->next = next;
     head->prev = NULL;
@@ -61,9 +58,9 @@ void push(int x, int print) {
         |* is finished until the queue is empty, the dealer is done generating,
         |* and the threads are not holding a popped number. This section incrememnts
         |* the game counter if the queue was empty and gets pushed to. */
-        pthread_mutex_lock(&gameLock); /* Begin critical section "push" */
+        lockstatLock(&gameLock); /* Begin critical section "push" */
         game++;
-        pthread_mutex_unlock(&gameLock); /* End critical section "push" */
+        lockstatUnlock(&gameLock); /* End critical section "push" */
     }
     if(print)
         printQueue();
@@ -81,14 +78,14 @@ int pop(int print) {
         |* is finished until the queue is empty, the dealer is done generating,
         |* and the threads are not holding a popped number. This section decrements
         |* the game counter if the queue will be empty after getting popped. */
-        pthread_mutex_lock(&gameLock); /* Begin critical section "pop" */
+        lockstatLock(&gameLock); /* Begin critical section "pop" */
         game--;
-        pthread_mutex_unlock(&gameLock);  /* End critical section "pop" */
+        lockstatUnlock(&gameLock);  /* End critical section "pop" */
     } else {
         q->tail->next = NULL;
     }
     q->size -= 1;
-    free(tail);
+    nodeFree(tail);
     if(print)
         printQueue();
     return result;
@@ -123,16 +120,19 @@ int main(int argc, char *argv[])
     q->tail = NULL;
 
     /* Initialize queue lock */
-    if (pthread_mutex_init(&queueLock, NULL) != 0) {
+    if (lockstatInit(&queueLock, "queueLock") != 0) {
         printf("ERROR: Queue mutex initialization has failed\n");
         return -1;
     }
 
     /* Initialize game lock */
-    if (pthread_mutex_init(&gameLock, NULL) != 0) {
+    if (lockstatInit(&gameLock, "gameLock") != 0) {
         printf("ERROR: Game mutex initialization has failed\n");
         return -1;
     }
+
+    /* Lock statistics are reported at exit, or on SIGUSR1 */
+    lockstatEnableSignal(SIGUSR1);
     
     /* Initialize scores array */
     scores = malloc(sizeof(int) * N);
@@ -158,30 +158,30 @@ int main(int argc, char *argv[])
     printf("\n-- All threads ready --\n\n");
 
     /* Signal the game to start */
-    pthread_mutex_lock(&gameLock); /* Begin critical section "generating" after creating all threads */
+    lockstatLock(&gameLock); /* Begin critical section "generating" after creating all threads */
     game++;
-    pthread_mutex_unlock(&gameLock); /* End critical section "generating" after making sure the game will continue */
+    lockstatUnlock(&gameLock); /* End critical section "generating" after making sure the game will continue */
         
     /* Repeat until T numbers generated */
     srand(time(NULL));
     int numbers = T;
     while(numbers) {
         /* Generate a new number if queue has N or fewer numbers */
-        pthread_mutex_lock(&queueLock); /* Begin critical section "deal" to push a number to the queue */
+        lockstatLock(&queueLock); /* Begin critical section "deal" to push a number to the queue */
         if(q->size <= N) {
             int x = rand() % 40;
             printf("Dealer is pushing %d to the queue\n", x);
             push(x, 1);
             numbers--;
         }
-        pthread_mutex_unlock(&queueLock); /* End critical section "deal" after the number has been pushed */
+        lockstatUnlock(&queueLock); /* End critical section "deal" after the number has been pushed */
     }
 
     printf("Done generating\n");
 
-    pthread_mutex_lock(&gameLock); /* Begin critical section "done" after generating all T numbers */
+    lockstatLock(&gameLock); /* Begin critical section "done" after generating all T numbers */
     game--;
-    pthread_mutex_unlock(&gameLock); /* End critical section "done" after ending the main process's need for the game to be running */
+    lockstatUnlock(&gameLock); /* End critical section "done" after ending the main process's need for the game to be running */
 
     /* Wait for all threads to finish */
     for(int i = 0; i < N; i++) {
@@ -206,13 +206,13 @@ void *runner(void *param) {
 
     /* Repeat until the game ends */
     while(game) {
-        pthread_mutex_lock(&queueLock); /* Begin critical section "grab" while game is still running */
+        lockstatLock(&queueLock); /* Begin critical section "grab" while game is still running */
         /* If the queue is not empty */
         if(q->size > 0) {
             /* Get the next number */
-            pthread_mutex_lock(&gameLock); /* Begin critical section "hold" if there are numbers in the queue */
+            lockstatLock(&gameLock); /* Begin critical section "hold" if there are numbers in the queue */
             game++;
-            pthread_mutex_unlock(&gameLock); /* End critical section "hold" after making sure the game will continue */
+            lockstatUnlock(&gameLock); /* End critical section "hold" after making sure the game will continue */
             int x = pop(0);
             int score;
             int result;
@@ -229,7 +229,7 @@ void *runner(void *param) {
             printQueue();
 
             /* Sleep for 1 + x ms */
-            pthread_mutex_unlock(&queueLock); /* End critical section "grab" after a number has been taken from the queue and saved */
+            lockstatUnlock(&queueLock); /* End critical section "grab" after a number has been taken from the queue and saved */
             struct timespec req, rem;
             req.tv_sec = 0;
             req.tv_nsec = x * 1000000 + 1;
@@ -240,21 +240,21 @@ void *runner(void *param) {
                 scores[k] += score;
             } else if((x % N == k) || (x % N == (k + 1) % N)) {
                 scores[k] += score;
-                pthread_mutex_lock(&queueLock); /* Begin critical section "matched"  if a number needs to be pushed to the queue */
+                lockstatLock(&queueLock); /* Begin critical section "matched"  if a number needs to be pushed to the queue */
                 printf("Thread %d is pushing %d to the queue\n", k, x - score);
                 push(x - score, 1);
-                pthread_mutex_unlock(&queueLock); /* End critical section "matched"  after the number has been pushed */
+                lockstatUnlock(&queueLock); /* End critical section "matched"  after the number has been pushed */
             } else {
-                pthread_mutex_lock(&queueLock); /* Begin critical section "fail" if a number needs to be pushed to the queue */
+                lockstatLock(&queueLock); /* Begin critical section "fail" if a number needs to be pushed to the queue */
                 printf("Thread %d is pushing %d to the queue\n", k, x - 2);
                 push(x - 2, 1);
-                pthread_mutex_unlock(&queueLock); /* End critical section "fail" after the number has been pushed */
+                lockstatUnlock(&queueLock); /* End critical section "fail" after the number has been pushed */
             }
-            pthread_mutex_lock(&gameLock); /* Begin critical section "release" after dealing with the object */
+            lockstatLock(&gameLock); /* Begin critical section "release" after dealing with the object */
             game--;
-            pthread_mutex_unlock(&gameLock); /* End critical section "release" after ending the threads need for the game to be running */
+            lockstatUnlock(&gameLock); /* End critical section "release" after ending the threads need for the game to be running */
         } else {
-            pthread_mutex_unlock(&queueLock); /* End critical section "grab" if there is no number to take from the queue */
+            lockstatUnlock(&queueLock); /* End critical section "grab" if there is no number to take from the queue */
         }
     }
 }
\ No newline at end of file
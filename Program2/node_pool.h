@@ -0,0 +1,92 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/* Node pool for the linked list queues. Nodes are carved out of
+|* slabs and never returned to malloc. Each thread keeps its own
+|* cache of free nodes, so nodeAlloc() and nodeFree() normally do
+|* not touch any shared state. When a cache runs dry or grows too
+|* large it trades a whole batch of nodes with the shared pool,
+|* which is the only place a lock is taken. */
+
+#define POOL_SLAB 256 /* Nodes carved out of each slab */
+#define POOL_BATCH 64 /* Nodes moved between a thread cache and the shared pool at once */
+
+struct Node {
+    int x;
+    struct Node* next;
+    struct Node* prev;
+};
+
+/* Free nodes owned by one thread, chained through next */
+struct NodeCache {
+    struct Node* free;
+    int count;
+};
+
+static _Thread_local struct NodeCache nodeCache; /* Cache of the calling thread */
+static struct Node* poolBatches = NULL; /* Shared batches of POOL_BATCH free nodes, chained through prev of the first node */
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER; /* Mutex for shared batches */
+
+/* Refills the calling thread's cache with a batch from the
+|* shared pool, or with a new slab if the pool is empty */
+static void nodeRefill() {
+    pthread_mutex_lock(&poolLock); /* Begin critical section "refill" to take a batch */
+    struct Node* batch = poolBatches;
+    if(batch != NULL)
+        poolBatches = batch->prev;
+    pthread_mutex_unlock(&poolLock); /* End critical section "refill" after taking a batch */
+
+    if(batch != NULL) {
+        nodeCache.free = batch;
+        nodeCache.count = POOL_BATCH;
+        return;
+    }
+
+    struct Node* slab = malloc(sizeof(struct Node) * POOL_SLAB);
+    for(int i = 0; i < POOL_SLAB - 1; i++) {
+        slab[i].next = &slab[i + 1];
+    }
+    slab[POOL_SLAB - 1].next = NULL;
+    nodeCache.free = slab;
+    nodeCache.count = POOL_SLAB;
+}
+
+/* Returns a node from the calling thread's cache */
+static struct Node* nodeAlloc() {
+    if(nodeCache.free == NULL)
+        nodeRefill();
+    struct Node* node = nodeCache.free;
+    nodeCache.free = node->next;
+    nodeCache.count--;
+    return node;
+}
+
+/* Returns a node to the calling thread's cache. Once the cache
+|* holds two batches, one batch is handed back to the shared pool
+|* so threads that only free do not hoard nodes. */
+static void nodeFree(struct Node* node) {
+    node->next = nodeCache.free;
+    nodeCache.free = node;
+    nodeCache.count++;
+    if(nodeCache.count < 2 * POOL_BATCH)
+        return;
+
+    struct Node* batch = nodeCache.free;
+    struct Node* last = batch;
+    for(int i = 1; i < POOL_BATCH; i++) {
+        last = last->next;
+    }
+    nodeCache.free = last->next;
+    nodeCache.count -= POOL_BATCH;
+    last->next = NULL;
+
+    pthread_mutex_lock(&poolLock); /* Begin critical section "spill" to give back a batch */
+    batch->prev = poolBatches;
+    poolBatches = batch;
+    pthread_mutex_unlock(&poolLock); /* End critical section "spill" after giving back the batch */
+}
+
+#endif
@@ -1,41 +1,89 @@
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include "node_pool.h"
+#include "../Common/lockstat.h"
 #include <string.h>
 
-/* Implementing queue as linked list */
-struct Node {
-    int x;
-    struct Node* next;
-    struct Node* prev;
-};
+/* Implementing queue as linked list of pooled nodes */
 struct Queue {
     int size;
     struct Node* head;
     struct Node* tail;
 };
 
+/* One-shot completion latch. Waiters sleep until the latch is
+|* opened, and it stays open until it is reset for the next game. */
+struct Latch {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int open;
+};
+
 int N; /* Number of slots */
 int T; /* Number of objects */
 int p; /* Number of players */
 int start = 0; /* Signal to start each game */
 int end = 0; /* Signal to end the whole game */
 int threads = 0; /* Number of threads running */
-int nextPlayer; /* Index of slot for next player to fill */
+atomic_int nextPlayer; /* Ticket for the next player into the game */
 int *scores; /* Array of scores of the player in each slot */
 char **names; /* Array of names of the player in each slot */
 struct Queue* q; /* FIFO queue */
-pthread_mutex_t queueLock; /* Mutex for FIFO queue */
+struct LockStat queueLock; /* Mutex for FIFO queue */
 
 
-int game = 0; /* Count of players still playing the game
-              |* (including dealer & queue). Ensures that
-              |* the game does not end until the dealer
-              |* has stopped generating numbers and all
-              |* players have emptied their hands. */
-pthread_mutex_t gameLock; /* Mutex for player count */
+atomic_int game = 0; /* Count of players still playing the game
+                     |* (including dealer & queue). Ensures that
+                     |* the game does not end until the dealer
+                     |* has stopped generating numbers and all
+                     |* players have emptied their hands. */
+struct Latch gameOver; /* Opened when the game count drops to 0 */
+
+/* Initializes a closed latch. Returns 0 on success. */
+int latchInit(struct Latch *l) {
+    l->open = 0;
+    if(pthread_mutex_init(&l->lock, NULL) != 0)
+        return -1;
+    return pthread_cond_init(&l->cond, NULL);
+}
+
+/* Opens the latch and wakes every waiter */
+void latchOpen(struct Latch *l) {
+    pthread_mutex_lock(&l->lock);
+    l->open = 1;
+    pthread_cond_broadcast(&l->cond);
+    pthread_mutex_unlock(&l->lock);
+}
+
+/* Sleeps until the latch is opened */
+void latchWait(struct Latch *l) {
+    pthread_mutex_lock(&l->lock);
+    while(!l->open)
+        pthread_cond_wait(&l->cond, &l->lock);
+    pthread_mutex_unlock(&l->lock);
+}
+
+/* Closes the latch again for the next game */
+void latchReset(struct Latch *l) {
+    pthread_mutex_lock(&l->lock);
+    l->open = 0;
+    pthread_mutex_unlock(&l->lock);
+}
+
+/* Takes a reference on the game so it cannot end */
+void gameHold() {
+    atomic_fetch_add(&game, 1);
+}
+
+/* Drops a reference on the game. The last reference opens the gameOver latch. */
+void gameRelease() {
+    if(atomic_fetch_sub(&game, 1) == 1)
+        latchOpen(&gameOver);
+}
 
 /* Prints the FIFO queue from last in to first in */
 void printQueue() {
@@ -53,7 +101,7 @@ void printQueue() {
 |* is nonzero. */
 void push(int x, int print) {
     struct Node* next = q->head;
-    struct Node* head = malloc(sizeof(struct Node));
+    struct Node* head = nodeAlloc();
     head->x = x;
     head->next = next;
     head->prev = NULL;
@@ -63,13 +111,11 @@ void push(int x, int print) {
     q->size += 1;
     if(q->size == 1) {
         q->tail = q->head;
-        /* Critical section "push" is necessary to keep the threads from thinking the
-        |* is finished until the queue is empty, the dealer is done generating,
-        |* and the threads are not holding a popped number. This section incrememnts
-        |* the game counter if the queue was empty and gets pushed to. */
-        pthread_mutex_lock(&gameLock); /* Begin critical section "push" */
-        game++;
-        pthread_mutex_unlock(&gameLock); /* End critical section "push" */
+        /* The queue holds a reference on the game while it is not empty, to keep
+        |* the threads from thinking the game is finished until the queue is empty,
+        |* the dealer is done generating, and the threads are not holding a popped
+        |* number. This takes the reference if the queue was empty and gets pushed to. */
+        gameHold();
     }
     if(print)
         printQueue();
@@ -83,18 +129,14 @@ int pop(int print) {
     q->tail = tail->prev;
     if(q->size == 1) {
         q->head = NULL;
-        /* Critical section "pop" is necessary to keep the threads from thinking the
-        |* is finished until the queue is empty, the dealer is done generating,
-        |* and the threads are not holding a popped number. This section decrements
-        |* the game counter if the queue will be empty after getting popped. */
-        pthread_mutex_lock(&gameLock); /* Begin critical section "pop" */
-        game--;
-        pthread_mutex_unlock(&gameLock);  /* End critical section "pop" */
+        /* Drops the queue's reference on the game if the queue will be empty
+        |* after getting popped. */
+        gameRelease();
     } else {
         q->tail->next = NULL;
     }
     q->size -= 1;
-    free(tail);
+    nodeFree(tail);
     if(print)
         printQueue();
     return result;
@@ -108,7 +150,7 @@ void resetGame(int print) {
         scores[i] = 0;
     }
 
-    pthread_mutex_lock(&queueLock);
+    lockstatLock(&queueLock);
     if(print)
         printf("Clearing queue...\n");
     while(q->size > 0) {
@@ -116,7 +158,7 @@ void resetGame(int print) {
     }
     if(print)
         printQueue();
-    pthread_mutex_unlock(&queueLock);
+    lockstatUnlock(&queueLock);
 }
 
 /* Function passed to pthreads */
@@ -154,14 +196,17 @@ int main(int argc, char *argv[])
     q->tail = NULL;
 
     /* Initialize queue lock */
-    if (pthread_mutex_init(&queueLock, NULL) != 0) {
+    if (lockstatInit(&queueLock, "queueLock") != 0) {
         printf("ERROR: Queue mutex initialization has failed\n");
         return -1;
     }
 
-    /* Initialize game lock */
-    if (pthread_mutex_init(&gameLock, NULL) != 0) {
-        printf("ERROR: Game mutex initialization has failed\n");
+    /* Lock statistics are reported at exit, or on SIGUSR1 */
+    lockstatEnableSignal(SIGUSR1);
+
+    /* Initialize game over latch */
+    if (latchInit(&gameOver) != 0) {
+        printf("ERROR: Game latch initialization has failed\n");
         return -1;
     }
     
@@ -170,8 +215,8 @@ int main(int argc, char *argv[])
     names = malloc(sizeof(char*) * p);
     resetGame(0); /* Initialize scores to 0 */
 
-    /* Sets the index of the next player into the game */
-    nextPlayer = N;
+    /* Sets the ticket of the next player into the game */
+    atomic_init(&nextPlayer, N);
 
     /* Create all threads */
     pthread_t tid[N];
@@ -201,10 +246,9 @@ int main(int argc, char *argv[])
         printf("\n\n"
         "----- Begin Game! -----\n\n");
 
-        /* Signal the game to start */
-        pthread_mutex_lock(&gameLock); /* Begin critical section "generating" after creating all threads */
-        game++;
-        pthread_mutex_unlock(&gameLock); /* End critical section "generating" after making sure the game will continue */
+        /* Signal the game to start. The dealer holds a reference until it is done generating. */
+        latchReset(&gameOver);
+        gameHold();
         start = 1;
 
         /* Repeat until T numbers generated */
@@ -212,23 +256,21 @@ int main(int argc, char *argv[])
         int numbers = T;
         while(numbers) {
             /* Generate a new number if queue has N or fewer numbers */
-            pthread_mutex_lock(&queueLock); /* Begin critical section "deal" to push a number to the queue */
+            lockstatLock(&queueLock); /* Begin critical section "deal" to push a number to the queue */
             if(q->size <= N) {
                 int x = rand() % 40;
                 printf("Dealer is pushing %d to the queue\n", x);
                 push(x, 1);
                 numbers--;
             }
-            pthread_mutex_unlock(&queueLock); /* End critical section "deal" after the number has been pushed */
+            lockstatUnlock(&queueLock); /* End critical section "deal" after the number has been pushed */
         }
 
         printf("Done generating\n");
 
-        pthread_mutex_lock(&gameLock); /* Begin critical section "done" after generating all T numbers */
-        game--;
-        pthread_mutex_unlock(&gameLock); /* End critical section "done" after ending the main process's need for the game to be running */
+        gameRelease(); /* Ends the main process's need for the game to be running */
 
-        while(game); /* Busy waiting */
+        latchWait(&gameOver); /* Sleep until the last reference is dropped */
         start = 0; /* Make threads wait at the end of the game */
 
         /* Print the final score for each player */
@@ -244,12 +286,12 @@ int main(int argc, char *argv[])
 
         printf("\nWinner: %s, with %d points\n", names[winner], scores[winner]);
 
-        /* If the index of the next player is less than the
+        /* If the ticket of the next player is less than the
         |* total number of players, reset and continue */
-        if(nextPlayer < p) {
+        int ticket = atomic_fetch_add(&nextPlayer, 1);
+        if(ticket < p) {
             resetGame(1);
-            names[winner] = players[nextPlayer]; /* Replace the winner with the next player */
-            nextPlayer++; /* Increment the index of the new next player */
+            names[winner] = players[ticket]; /* Replace the winner with the next player */
             max = -1; /* Reset the highest score from the game */
             winner = -1; /* Reset who the winner is */
         } else {
@@ -278,13 +320,11 @@ void *runner(void *param) {
     while(!end) {
         /* Continue while there are still numbers in play in the dealer or players hands or in the queue */
         while(game) {
-            pthread_mutex_lock(&queueLock); /* Begin critical section "grab" while game is still running */
+            lockstatLock(&queueLock); /* Begin critical section "grab" while game is still running */
             /* If the queue is not empty */
             if(q->size > 0) {
                 /* Get the next number */
-                pthread_mutex_lock(&gameLock); /* Begin critical section "hold" if there are numbers in the queue */
-                game++;
-                pthread_mutex_unlock(&gameLock); /* End critical section "hold" after making sure the game will continue */
+                gameHold(); /* Make sure the game will continue while holding the number */
                 int x = pop(0);
                 int score;
                 int result;
@@ -301,7 +341,7 @@ void *runner(void *param) {
                 printQueue();
 
                 /* Sleep for 1 + x ms */
-                pthread_mutex_unlock(&queueLock); /* End critical section "grab" after a number has been taken from the queue and saved */
+                lockstatUnlock(&queueLock); /* End critical section "grab" after a number has been taken from the queue and saved */
                 struct timespec req, rem;
                 req.tv_sec = 0;
                 req.tv_nsec = x * 1000000 + 1;
@@ -312,24 +352,22 @@ void *runner(void *param) {
                     scores[k] += score;
                 } else if((x % N == k) || (x % N == (k + 1) % N)) {
                     scores[k] += score;
-                    pthread_mutex_lock(&queueLock); /* Begin critical section "matched" if a number needs to be pushed to the queue */
+                    lockstatLock(&queueLock); /* Begin critical section "matched" if a number needs to be pushed to the queue */
                     printf("Thread %d is pushing %d to the queue\n", k, x - score);
                     push(x - score, 1);
-                    pthread_mutex_unlock(&queueLock); /* End critical section "matched" after the number has been pushed */
+                    lockstatUnlock(&queueLock); /* End critical section "matched" after the number has been pushed */
                 } else {
-                    pthread_mutex_lock(&queueLock); /* Begin critical section "fail" if a number needs to be pushed to the queue */
+                    lockstatLock(&queueLock); /* Begin critical section "fail" if a number needs to be pushed to the queue */
                     printf("Thread %d is pushing %d to the queue\n", k, x - 2);
                     push(x - 2, 1);
-                    pthread_mutex_unlock(&queueLock); /* End critical section "fail" after the number has been pushed */
+                    lockstatUnlock(&queueLock); /* End critical section "fail" after the number has been pushed */
                 }
-                pthread_mutex_lock(&gameLock); /* Begin critical section "release" after dealing with the object */
-                game--;
-                pthread_mutex_unlock(&gameLock); /* End critical section "release" after ending the threads need for the game to be running */
+                gameRelease(); /* End the thread's need for the game to be running after dealing with the object */
             } else {
-                pthread_mutex_unlock(&queueLock); /* End critical section "grab" if there is no number to take from the queue */
+                lockstatUnlock(&queueLock); /* End critical section "grab" if there is no number to take from the queue */
             }
 
             while(!start); /* Busy waiting at the end of each game */
         }
     }
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -1,84 +1,201 @@
 #include <pthread.h>
 #include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
+#include "../Common/cqueue.h"
+#include "../Common/lockstat.h"
 
-/* Implementing queue as linked list */
-struct Node {
-    int x;
-    struct Node* next;
-    struct Node* prev;
+#define CACHE_LINE 64 /* Size of a cache line, used to pad per-slot state */
+#define MAX_SHARD 256 /* Largest capacity of one numbers queue shard */
+
+/* Prints game events unless running headless */
+#define TRACE(...) do { if(!headless) printf(__VA_ARGS__); } while(0)
+
+/* Record for one player. Names are stored back to back in a
+|* single arena, and a player only keeps the offset of its name. */
+struct Player {
+    int score; /* Score of the player */
+    uint32_t name; /* Offset of the name in nameArena */
+    int slot; /* Slot the player is sitting in, -1 if not seated */
+};
+
+/* Seeded pseudo-random generator (xorshift64*). Each thread owns
+|* one, so a run with the same seed deals the same numbers. */
+struct Rng {
+    uint64_t s;
 };
-struct Queue {
-    int size;
-    struct Node* head;
-    struct Node* tail;
+
+/* Scoring statistics for one slot, padded so slots do not share a cache line */
+struct SlotStats {
+    long pops; /* Numbers popped */
+    long steals; /* Numbers popped from a shard the slot cannot match */
+    long scored; /* Numbers <= N scored outright */
+    long matched; /* Numbers matched to the slot */
+    long failed; /* Numbers the slot could not match */
+    long points; /* Points scored by all players in the slot */
+    long players; /* Players that finished in the slot */
+    long virtualMs; /* Milliseconds the slot would have slept */
+    char pad[CACHE_LINE - 8 * sizeof(long)];
 };
 
 int N; /* Number of slots */
 int T; /* Number of objects (ignored, left in for file compatibility) */
 int p; /* Number of players */
-int start = 0; /* Signal to start each game */
-int end = 0; /* Signal to end the whole game */
+atomic_int start = 0; /* Signal to start each game */
+atomic_int end = 0; /* Signal to end the whole game */
 int threads = 0; /* Number of threads running */
-int *scores; /* Array of scores of the player in each slot */
-char **names; /* Array of names of the player in each slot */
-int *playerScores; /* Array of all player scores */
-char **playerNames; /* Array of all player names */
-struct Queue* numbers; /* Numbers queue */
-pthread_mutex_t queueLock; /* Mutex for numbers queue */
-struct Queue* players; /* Players queue */
-pthread_mutex_t playerLock; /* Mutex for players queue */
-
-/* Prints the passed  queue from last in to first in */
-void printQueue(struct Queue *q) {
-    struct Node* current = q->head;
+uint64_t seed; /* Seed for the dealer and slot generators */
+int virtualTime = 0; /* Skip the per-number sleeps and only count the time */
+int headless = 0; /* Suppress game events and report throughput instead */
+int dumpPeriod = -1; /* Dump the numbers queue every dumpPeriod deals (0 = only on SIGUSR1) */
+volatile sig_atomic_t dumpRequested = 0; /* Set by SIGUSR1 to request a dump of the numbers queue */
+struct SlotStats *stats; /* Array of statistics for each slot */
+struct LockStat dealerLock; /* Mutex for thread count and dealer wakeups */
+pthread_cond_t spaceCond; /* Signaled when the numbers queue has room or a thread joins or finishes */
+struct Player *playerTable; /* Array of all players, in input order */
+char *nameArena; /* All player names, each terminated by '\0' */
+enum CQueueBackend backend = CQUEUE_RING; /* Queue implementation used for the shards */
+struct CQueue** shards; /* Numbers queue, split into one shard per residue x % N */
+atomic_int queued; /* Count of numbers across all shards */
+atomic_int dealerWaiting; /* Set while the dealer sleeps on spaceCond for room in the numbers queue */
+atomic_int nextWaiting; /* Players queue: index of the next waiting player in playerTable */
+
+/* Seeds the generator for one thread. Each stream gets its own
+|* state by mixing the stream number into the seed (splitmix64). */
+void rngSeed(struct Rng *r, uint64_t seed, uint64_t stream) {
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    r->s = (z ^ (z >> 31)) | 1;
+}
+
+/* Returns the next 32 random bits of the generator */
+uint32_t rngNext(struct Rng *r) {
+    r->s ^= r->s >> 12;
+    r->s ^= r->s << 25;
+    r->s ^= r->s >> 27;
+    return (uint32_t) ((r->s * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+/* Returns the current monotonic time in seconds */
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Returns the name of player i */
+char *playerName(int i) {
+    return nameArena + playerTable[i].name;
+}
+
+/* Takes the next waiting player off the players queue. Players
+|* never rejoin the queue, so it is the tail of playerTable and a
+|* swap is a single atomic increment of its head. Returns -1 once
+|* every player has been seated. */
+int nextPlayer() {
+    int i = atomic_fetch_add(&nextWaiting, 1);
+    return i < p ? i : -1;
+}
+
+/* Pushes x to a shard, yielding until there is room */
+void shardPush(struct CQueue *shard, int x) {
+    while(cqueuePush(shard, (void *) (intptr_t) x) != 0)
+        sched_yield();
+}
+
+/* Pops the oldest number of a shard into *x. Returns 1 on success, 0 if the shard is empty. */
+int shardPop(struct CQueue *shard, int *x) {
+    void *item;
+    if(!cqueueTryPop(shard, &item))
+        return 0;
+    *x = (int) (intptr_t) item;
+    return 1;
+}
+
+/* Copies every shard of the numbers queue out and then prints the
+|* copy from last in to first in, so the shards are only touched for
+|* the length of the copy. */
+void dumpNumbers() {
+    size_t *counts = malloc(sizeof(size_t) * N);
+    void **buf = malloc(sizeof(void *) * N * MAX_SHARD);
+    size_t total = 0;
+    for(int i = 0; i < N; i++) {
+        counts[i] = cqueueSnapshot(shards[i], buf + total, MAX_SHARD);
+        total += counts[i];
+    }
+
+    flockfile(stdout);
     printf("\n(");
-    while(current != NULL) {
-        printf(" %d", current->x);
-        current = current->next;
+    for(size_t i = 0, j = 0; i < (size_t) N; i++) {
+        if(i > 0)
+            printf(" |");
+        for(size_t k = j + counts[i]; k > j; k--)
+            printf(" %d", (int) (intptr_t) buf[k - 1]);
+        j += counts[i];
     }
     printf(" )\n\n");
+    funlockfile(stdout);
+    free(counts);
+    free(buf);
 }
 
-/* Pushes an integer x to a new node at the beginning
-|* of the passed queue. Calls printQueue() if second
-|* argument is nonzero. */
-void push(struct Queue *q, int x, int print) {
-    struct Node* next = q->head;
-    struct Node* head = malloc(sizeof(struct Node));
-    head->x = x;
-    head->next = next;
-    head->prev = NULL;
-    if(next != NULL)
-        next->prev = head;
-    q->head = head;
-    q->size += 1;
-    if(q->size == 1) {
-        q->tail = q->head;
+/* Dumps the numbers queue if SIGUSR1 has been received */
+void checkDump() {
+    if(dumpRequested) {
+        dumpRequested = 0;
+        dumpNumbers();
     }
-    if(print)
-        printQueue(q);
 }
 
-/* Returns the integer in the node at the end of the passed
-|* queue. Calls printQueue() if second argument is not 0. */
-int pop(struct Queue *q, int print) {
-    struct Node* tail = q->tail;
-    int result = tail->x;
-    q->tail = tail->prev;
-    if(q->size == 1) {
-        q->head = NULL;
-    } else {
-        q->tail->next = NULL;
+/* Handler for SIGUSR1. Only sets a flag, the next thread to pop or deal does the dump. */
+void requestDump(int sig) {
+    (void) sig;
+    dumpRequested = 1;
+}
+
+/* Pushes x to the shard for its residue x % N */
+void pushNumber(int x) {
+    shardPush(shards[x % N], x);
+    atomic_fetch_add(&queued, 1);
+}
+
+/* Wakes the dealer if it is waiting for room in the numbers queue.
+|* The fence pairs with the dealer setting dealerWaiting before it
+|* rechecks queued, so either the dealer sees the pop or this sees
+|* the dealer waiting, and the lock is only taken to wake it. */
+void signalSpace() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&dealerWaiting, memory_order_relaxed)) {
+        lockstatLock(&dealerLock); /* Begin critical section "space" after a number has been popped */
+        pthread_cond_signal(&spaceCond);
+        lockstatUnlock(&dealerLock); /* End critical section "space" after waking the dealer */
     }
-    q->size -= 1;
-    free(tail);
-    if(print)
-        printQueue(q);
-    return result;
+}
+
+/* Pops a number for slot k into *x. Slot k can only match the
+|* residues k and k + 1, so it tries those two shards first and
+|* only steals from the other shards, nearest first, when both
+|* are empty. The generator picks which side to steal from first.
+|* Returns 1 for an own shard, 2 for a steal, 0 if all are empty. */
+int popNumber(int k, int *x, struct Rng *rng) {
+    int found = shardPop(shards[k], x) || shardPop(shards[(k + 1) % N], x);
+    int side = N > 2 ? rngNext(rng) & 1 : 0;
+    for(int i = 0; !found && i < N - 2; i++) {
+        int shard = i % 2 == side ? (k + 2 + i / 2) % N : (k - 1 - i / 2 + N) % N;
+        if(shardPop(shards[shard], x))
+            found = 2;
+    }
+    if(found && atomic_fetch_sub(&queued, 1) == N + 1)
+        signalSpace(); /* Only the pop that leaves N numbers can find the dealer waiting for room */
+    return found;
 }
 
 /* Function passed to pthreads */
@@ -88,110 +205,202 @@ void *runner(void *param);
 int main(int argc, char *argv[])
 {
     /* Preprocessing */
+    int opt;
+    seed = time(NULL);
+    while((opt = getopt(argc, argv, "s:vHd:b:")) != -1) {
+        switch(opt) {
+        case 's': /* Seed to replay */
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'v': /* Virtual time */
+            virtualTime = 1;
+            break;
+        case 'H': /* Headless */
+            headless = 1;
+            break;
+        case 'd': /* Dump period */
+            dumpPeriod = atoi(optarg);
+            break;
+        case 'b': /* Queue backend */
+            if(cqueueParseBackend(optarg, &backend) == 0)
+                break;
+            printf("ERROR: Unknown queue backend %s, expecting mutex, ring or two-lock\n\n", optarg);
+            return -1;
+        default:
+            printf("Usage: %s [-s seed] [-v] [-H] [-d period] [-b mutex|ring|two-lock] input\n\n", argv[0]);
+            return -1;
+        }
+    }
+
+    if(argc - optind != 1) {
+        printf("ERROR: Wrong number of arguments. Received %d, expecting 1.\n\n", argc - optind);
+        return -1;
+    }
+
     FILE *input;
-    input = fopen(argv[1], "r");
+    input = fopen(argv[optind], "r");
+    if(input == NULL) {
+        printf("ERROR: Could not open %s\n\n", argv[optind]);
+        return -1;
+    }
     fscanf(input, "%d", &N);
     fscanf(input, "%d", &T);
     fscanf(input, "%d\n", &p);
 
-    playerNames = malloc(sizeof(char*) * p);
-    playerScores = malloc(sizeof(int) * p);
+    /* Read every name into the arena in one pass */
+    playerTable = malloc(sizeof(struct Player) * p);
+    size_t arenaSize = 0;
+    size_t arenaCapacity = 64;
+    nameArena = malloc(arenaCapacity);
+    char *line = NULL;
+    size_t lineCapacity = 0;
     for(int i = 0; i < p; i++) {
-        playerNames[i] = malloc(sizeof(char) * 20);
-        fgets(playerNames[i], sizeof(playerNames[i]), input);
-        playerNames[i][strcspn(playerNames[i], "\n")] = '\0';
-        playerScores[i] = 0;
+        if(getline(&line, &lineCapacity, input) < 0) {
+            printf("ERROR: Expected %d players, found %d\n\n", p, i);
+            return -1;
+        }
+        size_t length = strcspn(line, "\n");
+        if(arenaSize + length + 1 > arenaCapacity) {
+            while(arenaSize + length + 1 > arenaCapacity)
+                arenaCapacity *= 2;
+            nameArena = realloc(nameArena, arenaCapacity);
+        }
+        memcpy(nameArena + arenaSize, line, length);
+        nameArena[arenaSize + length] = '\0';
+        playerTable[i].score = 0;
+        playerTable[i].name = arenaSize;
+        playerTable[i].slot = -1;
+        arenaSize += length + 1;
     }
+    free(line);
 
     fclose(input);
 
-    if(argc != 2) {
-        printf("ERROR: Wrong number of arguments. Received %d, expecting 1.\n\n", argc - 1);
-        return -1;
-    }
-
-    printf("Number of threads : %d\n", N);
+    /* By default dump the queue once per batch, or never when headless */
+    if(dumpPeriod < 0)
+        dumpPeriod = headless ? 0 : N + 1;
+    signal(SIGUSR1, requestDump);
 
-    /* Initialize numbers queue */
-    numbers = malloc(sizeof(struct Queue));
-    numbers->size = 0;
-    numbers->head = NULL;
-    numbers->tail = NULL;
+    TRACE("Number of threads : %d | Seed : %llu\n", N, (unsigned long long) seed);
 
-    /* Initialize players queue */
-    players = malloc(sizeof(struct Queue));
-    players->size = 0;
-    players->head = NULL;
-    players->tail = NULL;
-
-    /* Initialize numbers queue lock */
-    if (pthread_mutex_init(&queueLock, NULL) != 0) {
-        printf("ERROR: Queue mutex initialization has failed\n");
-        return -1;
+    /* Initialize numbers queue. The dealer keeps at most N + 1
+    |* numbers queued and every slot holds at most one more, so
+    |* 2N + 2 never blocks. Shards are capped for large N, since
+    |* pushes to a full shard just wait for its slots to drain. */
+    shards = malloc(sizeof(struct CQueue*) * N);
+    for(int i = 0; i < N; i++) {
+        shards[i] = cqueueCreate(backend, 2 * N + 2 < MAX_SHARD ? 2 * N + 2 : MAX_SHARD);
     }
+    atomic_init(&queued, 0);
+    atomic_init(&dealerWaiting, 0);
 
-    /* Initialize players queue lock */
-    if (pthread_mutex_init(&playerLock, NULL) != 0) {
-        printf("ERROR: Player mutex initialization has failed\n");
+    /* Initialize dealer lock and condition */
+    if (lockstatInit(&dealerLock, "dealerLock") != 0 || pthread_cond_init(&spaceCond, NULL) != 0) {
+        printf("ERROR: Dealer mutex initialization has failed\n");
         return -1;
     }
-    
-    /* Initialize scores and names arrays */
-    scores = malloc(sizeof(int) * N);
-    names = malloc(sizeof(char*) * p);
-    for(int i = 0; i < N; i++) {
-        scores[i] = 0;
-    }
+
+    /* Lock statistics are reported at exit, or on SIGUSR2 (SIGUSR1 dumps the numbers queue) */
+    lockstatEnableSignal(SIGUSR2);
+
+    /* Initialize slot statistics */
+    stats = aligned_alloc(CACHE_LINE, sizeof(struct SlotStats) * N);
+    memset(stats, 0, sizeof(struct SlotStats) * N);
 
     /* Create all threads */
     pthread_t tid[N];
     pthread_attr_t attr;
     pthread_attr_init(&attr);
 
-    printf("\n--- Running Threads ---\n\n");
+    TRACE("\n--- Running Threads ---\n\n");
     for(int i = 0; i < N; i++)
     {
-        names[i] = playerNames[i]; /* Assigns first N players to N slots */
+        playerTable[i].slot = i; /* Assigns first N players to N slots */
         int *player = malloc(sizeof(int));
         *player = i;
         pthread_create(&(tid[i]), &attr, runner, (void *) player);
     }
 
-    /* Pushes the remaining players to a queue */
-    for(int i = N; i < p; i++) {
-        push(players, i, 0);
-    }
+    /* The remaining players wait in the players queue */
+    atomic_init(&nextWaiting, N);
 
     /* Waits until all N threads are ready */
-    while(threads < N);
-    printf("\n-- All threads ready --\n\n");
+    lockstatLock(&dealerLock); /* Begin critical section "ready" to read the thread count */
+    while(threads < N)
+        lockstatCondWait(&spaceCond, &dealerLock);
+    lockstatUnlock(&dealerLock); /* End critical section "ready" once every thread has joined */
+    TRACE("\n-- All threads ready --\n\n");
 
     /* Signal the game to start */
-    start = 1;
+    double started = now();
+    long dealt = 0;
+    struct Rng rng;
+    rngSeed(&rng, seed, N); /* Streams 0 to N - 1 belong to the slots */
+    atomic_store(&start, 1);
 
     /* Repeat until all threads have finished */
-    srand(time(NULL));
+    lockstatLock(&dealerLock); /* Begin critical section "deal" while threads are running */
     while(threads) {
-        /* Generate a new number if queue has N or fewer numbers */
-        pthread_mutex_lock(&queueLock); /* Begin critical section "deal" to push a number to the queue */
-        if(numbers->size <= N) {
-            int x = rand() % 40;
-            printf("Dealer is pushing %d to the queue\n", x);
-            push(numbers, x, 1);
+        /* Sleep until the queue has N or fewer numbers */
+        if(atomic_load(&queued) > N) {
+            atomic_store(&dealerWaiting, 1);
+            if(atomic_load(&queued) > N) /* Recheck, as pops before the flag was set did not signal */
+                lockstatCondWait(&spaceCond, &dealerLock);
+            atomic_store(&dealerWaiting, 0);
+            continue;
+        }
+        lockstatUnlock(&dealerLock); /* End critical section "deal" before dealing a batch */
+
+        /* Fill the queue back up to N + 1 numbers */
+        int size = atomic_load(&queued);
+        for(int i = size; i <= N; i++) {
+            int x = rngNext(&rng) % 40;
+            TRACE("Dealer is pushing %d to the queue\n", x);
+            pushNumber(x);
+            dealt++;
+            if(dumpPeriod > 0 && dealt % dumpPeriod == 0)
+                dumpNumbers();
         }
-        pthread_mutex_unlock(&queueLock); /* End critical section "deal" after the number has been pushed */
+        checkDump();
+        lockstatLock(&dealerLock); /* Begin critical section "deal" after the batch has been pushed */
     }
+    lockstatUnlock(&dealerLock); /* End critical section "deal" once all threads have finished */
 
     /* Wait for all threads to finish */
     for(int i = 0; i < N; i++) {
         pthread_join(tid[i], NULL);
     }
 
-    printf("\n------ Game Over ------\n\n");
+    double elapsed = now() - started;
+
+    TRACE("\n------ Game Over ------\n\n");
 
     /* Print the final score for each player */
-    for(int i = 0; i < p; i++) {
-        printf("Final score for Player %s: %d\n", playerNames[i], playerScores[i]);
+    for(int i = 0; i < p && !headless; i++) {
+        printf("Final score for Player %s: %d\n", playerName(i), playerTable[i].score);
+    }
+
+    /* Print throughput and per-slot statistics */
+    if(headless) {
+        long pops = 0;
+        long virtualMs = 0;
+        for(int i = 0; i < N; i++) {
+            pops += stats[i].pops;
+            if(stats[i].virtualMs > virtualMs)
+                virtualMs = stats[i].virtualMs;
+        }
+        printf("Seed : %llu | Slots : %d | Players : %d | Virtual time : %s | Queue : %s\n",
+               (unsigned long long) seed, N, p, virtualTime ? "on" : "off", cqueueBackendName(backend));
+        printf("Dealt %ld numbers, processed %ld in %.3f s (%.0f numbers/s)\n",
+               dealt, pops, elapsed, elapsed > 0 ? pops / elapsed : 0);
+        if(virtualTime)
+            printf("Longest slot virtual time : %ld ms\n", virtualMs);
+        printf("\n%4s %9s %9s %9s %9s %9s %9s %9s\n",
+               "Slot", "Pops", "Steals", "Scored", "Matched", "Failed", "Points", "Players");
+        for(int i = 0; i < N; i++) {
+            printf("%4d %9ld %9ld %9ld %9ld %9ld %9ld %9ld\n", i, stats[i].pops, stats[i].steals,
+                   stats[i].scored, stats[i].matched, stats[i].failed, stats[i].points, stats[i].players);
+        }
     }
 }
 
@@ -200,79 +409,95 @@ void *runner(void *param) {
     /* Preprocessing */
     int k = *((int*) param); /* Slot */
     int currentPlayer = k;
-    printf("Thread %d started\n", k);
+    struct Player *player = &playerTable[currentPlayer];
+    struct SlotStats *st = &stats[k];
+    struct Rng rng;
+    rngSeed(&rng, seed, k);
+    TRACE("Thread %d started\n", k);
+    lockstatLock(&dealerLock); /* Begin critical section "join" to count the thread */
     threads++;
+    pthread_cond_signal(&spaceCond); /* Let the dealer see the thread is ready */
+    lockstatUnlock(&dealerLock); /* End critical section "join" after counting the thread */
 
     /* Wait for the game start signal */
-    while(!start);
+    while(!atomic_load(&start))
+        sched_yield();
 
     /* Repeat until there are no players in the queue */
     while(!end) {
-        while(scores[k] < 100 && !end) {
-            pthread_mutex_lock(&queueLock); /* Begin critical section "grab" while game is still running */
-            /* If the queue is not empty */
-            if(numbers->size > 0) {
-                /* Get the next number */
-                int x = pop(numbers, 0);
+        while(player->score < 100 && !end) {
+            int x;
+            /* If the queue is not empty, get the next number */
+            int found = popNumber(k, &x, &rng);
+            if(found) {
                 int score;
                 int result;
-                printf("Player %s (Slot %d) popped %d from the queue.\n", names[k], k, x);
+                st->pops++;
+                st->steals += found == 2;
+                TRACE("Player %s (Slot %d) popped %d from the queue.\n", playerName(currentPlayer), k, x);
                 if(x <= N) {
                     score = x;
-                    printf("\tScored. Player will score %d. Nothing will be pushed.\n", score);
+                    st->scored++;
+                    TRACE("\tScored. Player will score %d. Nothing will be pushed.\n", score);
                 } else if((x % N == k) || (x % N == (k + 1) % N)) {
                     score = x * 2 / 5;
-                    printf("\tMatched. Player will score %d. Need to push 2x/5 back on queue\n", score);
+                    st->matched++;
+                    TRACE("\tMatched. Player will score %d. Need to push 2x/5 back on queue\n", score);
                 } else {
-                    printf("\tFailed. Player will not score. Need to push x - 2 back on queue\n");
+                    st->failed++;
+                    TRACE("\tFailed. Player will not score. Need to push x - 2 back on queue\n");
                 }
-                printQueue(numbers);
+                checkDump();
 
-                /* Sleep for 1 + x ms */
-                pthread_mutex_unlock(&queueLock); /* End critical section "grab" after a number has been taken from the queue and saved */
-                struct timespec req, rem;
-                req.tv_sec = 0;
-                req.tv_nsec = x * 1000000 + 1;
-                nanosleep(&req, &rem);
+                /* Sleep for 1 + x ms, or only count it in virtual time */
+                if(virtualTime) {
+                    st->virtualMs += x + 1;
+                } else {
+                    struct timespec req, rem;
+                    req.tv_sec = 0;
+                    req.tv_nsec = x * 1000000 + 1;
+                    nanosleep(&req, &rem);
+                }
 
                 /* Process scoring */
                 if(x <= N) {
-                    scores[k] += score;
+                    player->score += score;
+                    st->points += score;
                 } else if((x % N == k) || (x % N == (k + 1) % N)) {
-                    scores[k] += score;
-                    pthread_mutex_lock(&queueLock); /* Begin critical section "matched" if a number needs to be pushed to the queue */
-                    printf("Player %s (Slot %d) is pushing %d to the queue\n", names[k], k, x - score);
-                    push(numbers, x - score, 1);
-                    pthread_mutex_unlock(&queueLock); /* End critical section "matched" after the number has been pushed */
+                    player->score += score;
+                    st->points += score;
+                    TRACE("Player %s (Slot %d) is pushing %d to the queue\n", playerName(currentPlayer), k, x - score);
+                    pushNumber(x - score);
                 } else {
-                    pthread_mutex_lock(&queueLock); /* Begin critical section "fail" if a number needs to be pushed to the queue */
-                    printf("Player %s (Slot %d) is pushing %d to the queue\n", names[k], k, x - 2);
-                    push(numbers, x - 2, 1);
-                    pthread_mutex_unlock(&queueLock); /* End critical section "fail" after the number has been pushed */
+                    TRACE("Player %s (Slot %d) is pushing %d to the queue\n", playerName(currentPlayer), k, x - 2);
+                    pushNumber(x - 2);
                 }
             } else {
-                pthread_mutex_unlock(&queueLock); /* End critical section "grab" if there is no number to take from the queue */
+                sched_yield(); /* Let the dealer run while every shard is empty */
             }
         }
-        pthread_mutex_lock(&playerLock); /* Begin critical section "swap" once player score reaches 100 */
-        if(players->size == 0) { /* If the players queue is empty, leave the game. If the game has not been ended, end it */
-            printf("Player %s is leaving with a score of %d\n\n", names[k], scores[k]);
-            if(end == 0) {
-                printf("Player %s has ended the game.\n\n", names[k]);
+        /* Swap once player score reaches 100 */
+        st->players++;
+        int nextP = nextPlayer();
+        if(nextP < 0) { /* If the players queue is empty, leave the game. If the game has not been ended, end it */
+            TRACE("Player %s is leaving with a score of %d\n\n", playerName(currentPlayer), player->score);
+            if(atomic_exchange(&end, 1) == 0) {
+                TRACE("Player %s has ended the game.\n\n", playerName(currentPlayer));
             }
-            end = 1;
         } else { /* Otherwise, the current player will leave the game and a new player will swap in to that slot */
-            int oldPlayer = currentPlayer;
-            currentPlayer = pop(players, 0);
-            playerScores[oldPlayer] = scores[k];
-            names[k] = playerNames[currentPlayer];
-            scores[k] = 0;
-            printf("\nPlayer %s is leaving with a score of %d."
+            struct Player *oldPlayer = player;
+            currentPlayer = nextP;
+            player = &playerTable[currentPlayer];
+            player->slot = oldPlayer->slot; /* The new player takes over the old player's seat */
+            oldPlayer->slot = -1;
+            TRACE("\nPlayer %s is leaving with a score of %d."
                    "\nPlayer %s is starting with a score of %d in slot %d.\n\n",
-                   playerNames[oldPlayer], playerScores[oldPlayer], names[k], scores[k], k);
+                   nameArena + oldPlayer->name, oldPlayer->score, playerName(currentPlayer), player->score, player->slot);
         }
-        pthread_mutex_unlock(&playerLock); /* End critical section "swap" after leaving the game */
     }
-    playerScores[currentPlayer] = scores[k]; /* Update the final score of the player after the game ends */
+    player->slot = -1; /* The player leaves the table once the game ends */
+    lockstatLock(&dealerLock); /* Begin critical section "leave" once the game is over */
     threads--; /* Mark the thread as finished */
-}
\ No newline at end of file
+    pthread_cond_signal(&spaceCond); /* Let the dealer see the thread has finished */
+    lockstatUnlock(&dealerLock); /* End critical section "leave" after waking the dealer */
+}
\ No newline at end of file
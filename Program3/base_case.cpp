@@ -1,60 +1,89 @@
 #include <iostream>
 #include <fstream>
-#include <queue>
+#include <vector>
 #include <deque>
 #include <chrono>
 #include <thread>
 #include <iterator>
 #include <pthread.h>
+#include "../Common/cqueue.h"
+#include "../Common/lockstat.h"
+#include "resource_manager.h"
 
 using namespace std;
 
 class Philosopher
 {
 public:
-    Philosopher(int index, string name, deque<int> requests)
+    Philosopher(int index, string name, deque<pair<int, int>> requests)
     {
         this->requests = requests;
-        this->tools = requests.size();
         this->index = index;
         this->name = name;
     }
-    int index;           /* Index of the philosopher for the banker's algorithm structures */
-    int tools;           /* Number of tools needed */
-    string name;         /* Name of the philosopher */
-    deque<int> requests; /* List of tools needed */
+    int index;                      /* Index of the philosopher for the banker's algorithm structures */
+    string name;                    /* Name of the philosopher */
+    deque<pair<int, int>> requests; /* List of (tool, count) entries still needed */
+    ToolRequest held;               /* Tools granted before sitting down */
 };
 
+#define DETECT_PERIOD chrono::seconds(1) /* Time between deadlock detection passes */
+
 int k; /* Number of tool types */
 int m; /* Number of tables */
 int n; /* Number of philosophers */
 
-/* Structures for deadlock avoidance */
-vector<int> available;
-vector<vector<int>> maximum;
-vector<vector<int>> allocation;
+ResourceManager *pool; /* Tools shared by every table, guarded by deadlock avoidance or detection */
+DeadlockPolicy policy = AVOIDANCE; /* How the pool deals with deadlock */
 
-queue<Philosopher *> philosophers; /* Queue of philosophers waiting for a table */
+struct CQueue *philosophers; /* Queue of philosophers waiting for a table */
 
 string buffer;               /* Used to clear ifstream */
 int start = 0;               /* Start game signal */
 int threads = 0;             /* Number of threads running */
-pthread_mutex_t queueLock;   /* Lock for the philosopher queue */
-pthread_mutex_t outputLock;  /* Lock for printing to output */
-pthread_mutex_t requestLock; /* Lock for requesting a tool */
+struct LockStat outputLock;  /* Lock for printing to output */
 
 /* Function passed to pthreads */
 void *runner(void *param);
 
+/* Thread that breaks deadlocks in detection mode */
+void *detector(void *param);
+
+/* Prints the entries of a request, a single tool as "tool" and several units as "tool:count" */
+void printTools(const ToolRequest &tools)
+{
+    for (auto &entry : tools)
+    {
+        cout << " " << entry.first;
+        if (entry.second != 1)
+            cout << ":" << entry.second;
+    }
+}
+
 int main(int argc, char *argv[])
 {
     /* Preprocessing */
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        printf("ERROR: Wrong number of arguments. Received %d, expecting 1.\n\n", argc - 1);
+        printf("ERROR: Wrong number of arguments. Received %d, expecting 1 or 2.\n\n", argc - 1);
         return -1;
     }
 
+    /* Optional second argument picks deadlock avoidance (the default) or detection */
+    if (argc == 3)
+    {
+        string mode = argv[2];
+        if (mode == "avoid")
+            policy = AVOIDANCE;
+        else if (mode == "detect")
+            policy = DETECTION;
+        else
+        {
+            printf("ERROR: Unknown mode %s, expecting avoid or detect.\n\n", argv[2]);
+            return -1;
+        }
+    }
+
     ifstream input;
     input.open(argv[1]);
     input >> k; // Number of tool types
@@ -68,7 +97,7 @@ int main(int argc, char *argv[])
     }
 
     /* Reading in the starting tool counts as available */
-    available = vector<int>(k, 0);
+    vector<int> available(k, 0);
     for (int i = 0; i < k; i++)
     {
         input >> available[i];
@@ -80,47 +109,79 @@ int main(int argc, char *argv[])
     }
     getline(input, buffer);
 
-    /* Initializing maximum and allocation structures and creating philosopher objects */
-    maximum = vector<vector<int>>(n, vector<int>(k, 0));
-    allocation = vector<vector<int>>(n, vector<int>(k, 0));
+    /* Initializing maximum and allocation structures and creating philosopher objects.
+    |* Philosophers are only popped once each, so the queue uses the mutex backend. */
+    philosophers = cqueueCreate(CQUEUE_MUTEX, n);
+    vector<Philosopher *> seated; /* The philosophers that take the tables first */
+    vector<vector<int>> maximum(n, vector<int>(k, 0));
     for (int i = 0; i < n; i++)
     {
         string name;
         getline(input, name, ' ');
         int p;
         input >> p;
-        deque<int> requests;
+        deque<pair<int, int>> requests;
         for (int j = 0; j < p; j++)
         {
-            int x;
-            input >> x;
-            maximum[i][x]++;
-            requests.push_back(x);
+            /* Each entry is a tool, or tool:count for several units of it */
+            string entry;
+            input >> entry;
+            size_t colon = entry.find(':');
+            int x = stoi(entry.substr(0, colon));
+            int count = colon == string::npos ? 1 : stoi(entry.substr(colon + 1));
+            if (x < 0 || x >= k || count < 1)
+            {
+                printf("ERROR: Bad tool entry %s for philosopher #%d", entry.c_str(), i + 1);
+                return -1;
+            }
+            maximum[i][x] += count;
+            requests.push_back({x, count});
         }
-        philosophers.push(new Philosopher(i, name, requests));
+        Philosopher *philosopher = new Philosopher(i, name, requests);
+        cqueuePush(philosophers, philosopher);
+        if (i < m)
+            seated.push_back(philosopher);
         getline(input, buffer);
     }
 
-    /* Initialize queue lock */
-    if (pthread_mutex_init(&queueLock, NULL) != 0)
+    /* Initialize the tool pool. Its lock is reported as the request lock. */
+    pool = new ResourceManager("requestLock", available, maximum, policy);
+
+    /* The first philosopher at each table asks for its first tool entry as the game opens.
+    |* These requests all arrive at once, so they are admitted as one batch. Only
+    |* philosophers that sit down straight away are included, so nobody holds tools
+    |* while waiting for a table. */
+    vector<pair<int, ToolRequest>> opening;
+    vector<Philosopher *> asking;
+    for (Philosopher *p : seated)
     {
-        printf("ERROR: Queue mutex initialization has failed\n");
-        return -1;
+        if (p->requests.empty())
+            continue;
+        opening.push_back({p->index, ToolRequest(1, p->requests.front())});
+        asking.push_back(p);
+    }
+    vector<bool> admitted = pool->try_acquire_batch(opening);
+    for (size_t i = 0; i < opening.size(); i++)
+    {
+        Philosopher *p = asking[i];
+        if (!admitted[i])
+            continue;
+        p->held = opening[i].second;
+        p->requests.pop_front();
+        cout << p->name << " is handed";
+        printTools(p->held);
+        cout << " before sitting down" << endl;
     }
 
     /* Initialize output lock */
-    if (pthread_mutex_init(&outputLock, NULL) != 0)
+    if (lockstatInit(&outputLock, "outputLock") != 0)
     {
         printf("ERROR: Output mutex initialization has failed\n");
         return -1;
     }
 
-    /* Initialize request lock */
-    if (pthread_mutex_init(&requestLock, NULL) != 0)
-    {
-        printf("ERROR: Request mutex initialization has failed\n");
-        return -1;
-    }
+    /* Lock statistics are reported at exit, or on SIGUSR1 */
+    lockstatEnableSignal(SIGUSR1);
 
     /* Create all threads */
     pthread_t tid[m];
@@ -141,102 +202,31 @@ int main(int argc, char *argv[])
     printf("\n-- All threads ready --\n\n");
 
     /* Signal the game to start */
+    auto began = chrono::steady_clock::now();
     start = 1;
 
+    /* In detection mode, deadlocks are broken by a thread of their own */
+    pthread_t detectorTid;
+    if (policy == DETECTION)
+        pthread_create(&detectorTid, &attr, detector, NULL);
+
     /* Wait for all threads to finish */
     for (int i = 0; i < m; i++)
     {
         pthread_join(tid[i], NULL);
     }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - began).count();
+    start = 0;
+    if (policy == DETECTION)
+        pthread_join(detectorTid, NULL);
 
-    cout << "All done" << endl;
-}
-
-/* Calculate need structure for banker's algorithm */
-vector<vector<int>> calculateNeed(vector<vector<int>> &m, vector<vector<int>> &a)
-{
-    vector<vector<int>> need = vector<vector<int>>(n, vector<int>(k, 0));
-    for (int i = 0; i < n; i++)
-    {
-        for (int j = 0; j < k; j++)
-        {
-            need[i][j] = m[i][j] - a[i][j];
-        }
-    }
-
-    return need;
-}
+    /* Throughput, to compare the two modes on the same input */
+    ManagerStats stats = pool->statistics();
+    printf("\n--- %s mode ---\n", policy == AVOIDANCE ? "Avoidance" : "Detection");
+    printf("%d philosophers ate in %.2f s, %.3f per second\n", n, seconds, n / seconds);
+    printf("%ld requests, %ld granted, %ld rollbacks\n\n", stats.requests, stats.granted, stats.rollbacks);
 
-// Returns true if arr1 is less than or equal to arr2 for every item
-bool lteq(vector<int> &arr1, vector<int> &arr2)
-{
-    for (int i = 0; i < arr1.size(); i++)
-    {
-        if (arr1[i] > arr2[i])
-            return false;
-    }
-    return true;
-}
-
-/* Check if the given request will cause the state to be unsafe */
-bool safety(int index, vector<int> request, vector<int> available, vector<vector<int>> maximum, vector<vector<int>> allocation)
-{
-    vector<vector<int>> need = calculateNeed(maximum, allocation);
-    for (int i = 0; i < k; i++)
-    {
-        available[i] -= request[i];
-        allocation[index][i] += request[i];
-        need[index][i] -= request[i];
-    }
-
-    bool finish[n] = {false};
-
-    /* Find a philosopher which can finish with the available resources, and repeat until none are left */
-    for (int i = 0; i < n; i++)
-    {
-        if (finish[i] == false && lteq(need[i], available))
-        {
-            for (int j = 0; j < k; j++)
-            {
-                available[j] = available[j] + allocation[i][j];
-            }
-            finish[i] = true;
-            i = -1;
-        }
-    }
-
-    /* If all philosophers cannot finish, the state is unsafe */
-    for (int i = 0; i < n; i++)
-    {
-        if (!finish)
-            return false;
-    }
-
-    /* Otherwise, the state is safe */
-    return true;
-}
-
-/* Returns if a given request of tools is valid or not */
-bool request(int index, vector<int> tools)
-{
-    vector<vector<int>> need = calculateNeed(maximum, allocation);
-    vector<int> request(k, 0);
-    for (int tool : tools)
-    {
-        request[tool]++;
-    }
-
-    /* Throws error if philosopher requests more than he would need */
-    if (!lteq(request, need[index]))
-        throw overflow_error("Exceeded maximum allowed");
-
-    /* Returns false if there are not enough resources available */
-    if (!lteq(request, available))
-        return false;
-
-    /* Returns true or false based on of the request will cause on unsafe state */
-    bool result = safety(index, request, available, maximum, allocation);
-    return result;
+    cout << "All done" << endl;
 }
 
 /* Thread method (philosophers). Param is the index of the philosopher */
@@ -244,9 +234,9 @@ void *runner(void *param)
 {
     /* Preprocessing */
     int thread = *(int *)param;
-    pthread_mutex_lock(&queueLock);
+    lockstatLock(&outputLock);
     cout << "Starting thread " << thread << endl;
-    pthread_mutex_unlock(&queueLock);
+    lockstatUnlock(&outputLock);
 
     threads++;
 
@@ -258,71 +248,60 @@ void *runner(void *param)
     Philosopher *p;
     while (start)
     {
-        /* Grab a philosopher from the queue if there is one */
-        pthread_mutex_lock(&queueLock);
-        if (philosophers.size() > 0)
-        {
-            p = philosophers.front();
-            philosophers.pop();
-            pthread_mutex_unlock(&queueLock);
-        }
-        /* End the thread otherwise */
-        else
-        {
-            pthread_mutex_unlock(&queueLock);
+        /* Grab a philosopher from the queue if there is one, end the thread otherwise */
+        void *next;
+        if (!cqueueTryPop(philosophers, &next))
             break;
-        }
+        p = (Philosopher *)next;
 
-        pthread_mutex_lock(&outputLock);
+        lockstatLock(&outputLock);
         cout << p->name << " sits down at table " << thread << endl;
-        pthread_mutex_unlock(&outputLock);
+        lockstatUnlock(&outputLock);
 
-        /* Aqcquire tools */
-        deque<int> currentTools;
+        /* Aqcquire tools, starting from any granted before the game opened */
+        ToolRequest currentTools = p->held;
 
-        while (currentTools.size() < p->tools)
+        while (!p->requests.empty())
         {
             auto t = time(0);
             bool result;
-            vector<int> requestedTools;
+            ToolRequest requestedTools;
             /* Get the tools to request */
             for (int i = 0; i <= t % 2 && i < p->requests.size(); i++)
             {
-                int tool = p->requests.front();
+                requestedTools.push_back(p->requests.front());
                 p->requests.pop_front();
-                requestedTools.push_back(tool);
             }
 
             /* Request the tools */
-            pthread_mutex_lock(&requestLock);
-            pthread_mutex_lock(&outputLock);
+            bool granted = pool->try_acquire(p->index, requestedTools);
+            lockstatLock(&outputLock);
             cout << p->name << " requests";
-            for (auto tool : requestedTools)
-            {
-                cout << " " << tool;
-            }
-            bool granted = request(p->index, requestedTools);
+            printTools(requestedTools);
             cout << ", " << (granted ? "granted" : "denied") << endl;
-            pthread_mutex_unlock(&outputLock);
+            lockstatUnlock(&outputLock);
             if (granted)
             {
-                /* Adjust the allocation of tools if the request is granted */
-                for (auto tool : requestedTools)
-                {
-                    currentTools.push_back(tool);
-                    allocation[p->index][tool]++;
-                    available[tool]--;
-                }
+                /* Keep the tools if the request is granted */
+                currentTools.insert(currentTools.end(), requestedTools.begin(), requestedTools.end());
             }
             else
             {
                 /* Otherwise add those tools back to the list of requests */
-                for (auto tool : requestedTools)
+                p->requests.insert(p->requests.end(), requestedTools.begin(), requestedTools.end());
+
+                /* If the detector preempted this philosopher, the tools it held are gone and have to be asked for again */
+                if (pool->rolled_back(p->index))
                 {
-                    p->requests.push_back(tool);
+                    lockstatLock(&outputLock);
+                    cout << p->name << " is preempted, giving up";
+                    printTools(currentTools);
+                    cout << endl;
+                    lockstatUnlock(&outputLock);
+                    p->requests.insert(p->requests.end(), currentTools.begin(), currentTools.end());
+                    currentTools.clear();
                 }
             }
-            pthread_mutex_unlock(&requestLock);
 
             /* Sleep between requests */
             this_thread::sleep_for(chrono::seconds(2) + chrono::milliseconds(t % 1000));
@@ -332,19 +311,31 @@ void *runner(void *param)
         this_thread::sleep_for(chrono::seconds(2));
 
         /* Return tools */
-        pthread_mutex_lock(&requestLock);
-        pthread_mutex_lock(&outputLock);
-        cout << p->name << " finishes, releasing ";
-        for (auto tool : currentTools)
-        {
-            cout << tool << " ";
-            allocation[p->index][tool]--;
-            available[tool]++;
-        }
+        lockstatLock(&outputLock);
+        cout << p->name << " finishes, releasing";
+        printTools(currentTools);
         cout << endl;
-        pthread_mutex_unlock(&outputLock);
-        pthread_mutex_unlock(&requestLock);
+        lockstatUnlock(&outputLock);
+        pool->release(p->index, currentTools);
     }
 
     threads--;
+}
+
+/* Thread method (deadlock detection). Runs a detection pass every DETECT_PERIOD while the game is on */
+void *detector(void *param)
+{
+    (void)param;
+    while (start)
+    {
+        this_thread::sleep_for(DETECT_PERIOD);
+        int victim = pool->detect();
+        if (victim != -1)
+        {
+            lockstatLock(&outputLock);
+            cout << "Deadlock detected, preempting philosopher " << victim << endl;
+            lockstatUnlock(&outputLock);
+        }
+    }
+    return NULL;
 }
\ No newline at end of file
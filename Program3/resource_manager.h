@@ -0,0 +1,470 @@
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <cstdint>
+#include "../Common/lockstat.h"
+
+using namespace std;
+
+/* A request as a sparse list of (tool, count) entries, so asking for many units of one
+   tool is a single entry. A tool may appear in more than one entry. */
+typedef vector<pair<int, int>> ToolRequest;
+
+/* How the manager keeps the pool out of deadlock */
+enum DeadlockPolicy
+{
+    AVOIDANCE, /* Only grant requests that leave the pool in a safe state */
+    DETECTION  /* Grant anything that fits, and break deadlocks with detect() */
+};
+
+/* Counters of what the manager has done so far */
+struct ManagerStats
+{
+    long requests;  /* Requests made */
+    long granted;   /* Requests granted */
+    long rollbacks; /* Philosophers preempted to break a deadlock */
+};
+
+/*
+	Resource pool guarded by the banker's algorithm. The manager owns the
+	available, maximum and allocation structures for one pool, along with the
+	lock that protects them, so several independent pools can run in one process.
+*/
+class ResourceManager
+{
+public:
+    // name is used for the pool's lock in the lock statistics report
+    ResourceManager(const char *name, vector<int> available, vector<vector<int>> maximum, DeadlockPolicy policy = AVOIDANCE)
+    {
+        this->k = available.size();
+        this->n = maximum.size();
+        this->policy = policy;
+        this->available = available;
+        this->maximum = maximum;
+        this->allocation = vector<vector<int>>(n, vector<int>(k, 0));
+        this->waiting = vector<ToolRequest>(n);
+        this->preempted = vector<bool>(n, false);
+        this->stats = {0, 0, 0};
+        lockstatInit(&lock, name);
+    }
+    ResourceManager(const ResourceManager &) = delete;
+    ResourceManager &operator=(const ResourceManager &) = delete;
+    ~ResourceManager() { lockstatDestroy(&lock); }
+
+    // Grants the request to philosopher index if it leaves the pool in a safe state, or
+    // under DETECTION if it fits in what is available.
+    // Returns true if the request was granted, false if it has to wait. A philosopher
+    // that was preempted is refused until it has called rolled_back().
+    // Throws overflow_error if the philosopher asks for more than it declared.
+    bool try_acquire(int index, const ToolRequest &request)
+    {
+        lockstatLock(&lock);
+        stats.requests++;
+        bool granted = false;
+        try
+        {
+            if (!preempted[index])
+                granted = admit(index, request);
+        }
+        catch (...)
+        {
+            lockstatUnlock(&lock);
+            throw;
+        }
+        if (granted)
+        {
+            stats.granted++;
+            waiting[index].clear();
+        }
+        else
+        {
+            waiting[index] = request;
+        }
+        lockstatUnlock(&lock);
+        return granted;
+    }
+
+    // Returns tools held by philosopher index to the pool
+    void release(int index, const ToolRequest &release)
+    {
+        lockstatLock(&lock);
+        apply(index, release, -1);
+        waiting[index].clear();
+        lockstatUnlock(&lock);
+    }
+
+    // Returns true once if philosopher index was preempted since it last asked. Its tools
+    // are already back in the pool, so it starts over with everything still to request.
+    bool rolled_back(int index)
+    {
+        lockstatLock(&lock);
+        bool result = preempted[index];
+        preempted[index] = false;
+        lockstatUnlock(&lock);
+        return result;
+    }
+
+    // Looks for a deadlock among the philosophers waiting on a denied request, and breaks
+    // it by preempting the deadlocked philosopher holding the fewest tools, but at least one.
+    // Returns the preempted philosopher, or -1 if there was no deadlock.
+    int detect()
+    {
+        lockstatLock(&lock);
+        int victim = -1;
+        vector<int> work = available;
+        finish.assign((n + 63) / 64, 0);
+
+        /* Finish every philosopher whose pending request could be met by what the finished ones
+           give back. Philosophers that are not waiting have nothing pending and finish at once. */
+        bool progress = true;
+        while (progress)
+        {
+            progress = false;
+            for (int i = nextUnfinished(0); i < n; i = nextUnfinished(i + 1))
+            {
+                apply(work, waiting[i], -1);
+                bool fits = none_of(waiting[i].begin(), waiting[i].end(), [&](const pair<int, int> &entry)
+                                    { return work[entry.first] < 0; });
+                apply(work, waiting[i], 1);
+                if (!fits)
+                    continue;
+                for (int j = 0; j < k; j++)
+                {
+                    work[j] += allocation[i][j];
+                }
+                finish[i / 64] |= 1ULL << (i % 64);
+                progress = true;
+            }
+        }
+
+        /* Whoever is left is deadlocked. Only rolling back one that holds tools can free
+           anything, so waiters holding nothing are passed over. */
+        int fewest = 0;
+        for (int i = nextUnfinished(0); i < n; i = nextUnfinished(i + 1))
+        {
+            int held = accumulate(allocation[i].begin(), allocation[i].end(), 0);
+            if (held > 0 && (victim == -1 || held < fewest))
+            {
+                victim = i;
+                fewest = held;
+            }
+        }
+
+        /* Roll the victim back to holding nothing */
+        if (victim != -1)
+        {
+            for (int j = 0; j < k; j++)
+            {
+                available[j] += allocation[victim][j];
+                allocation[victim][j] = 0;
+            }
+            waiting[victim].clear();
+            preempted[victim] = true;
+            stats.rollbacks++;
+        }
+        lockstatUnlock(&lock);
+        return victim;
+    }
+
+    // Returns the counters so far
+    ManagerStats statistics()
+    {
+        lockstatLock(&lock);
+        ManagerStats result = stats;
+        lockstatUnlock(&lock);
+        return result;
+    }
+
+    // Admits as many of the pending (philosopher, request) pairs as it can under one lock
+    // round-trip. Requests are taken from the fewest tools up, skipping any that do not fit
+    // in what is available, and the longest run of those that leaves the pool safe is
+    // granted. Taking back a grant never makes a safe state unsafe, so that run is found by
+    // binary search, with O(log requests) safety passes. This is the largest safe set among
+    // runs of the smallest requests, not always the largest safe set overall, which would
+    // mean trying every subset.
+    // Returns whether each request, in the given order, was granted.
+    // Throws overflow_error if a philosopher asks for more than it declared.
+    vector<bool> try_acquire_batch(const vector<pair<int, ToolRequest>> &requests)
+    {
+        vector<bool> granted(requests.size(), false);
+        vector<int> order(requests.size());
+        iota(order.begin(), order.end(), 0);
+        stable_sort(order.begin(), order.end(), [&](int a, int b)
+                    { return total(requests[a].second) < total(requests[b].second); });
+
+        lockstatLock(&lock);
+        for (auto &r : requests)
+        {
+            apply(r.first, r.second, 1);
+            bool over = overMaximum(r.first, r.second);
+            apply(r.first, r.second, -1);
+            if (over)
+            {
+                lockstatUnlock(&lock);
+                throw overflow_error("Exceeded maximum allowed");
+            }
+        }
+
+        /* Tentatively grant every request that still fits */
+        vector<int> admitted;
+        for (int r : order)
+        {
+            int index = requests[r].first;
+            const ToolRequest &request = requests[r].second;
+            if (preempted[index])
+                continue;
+            apply(index, request, 1);
+            if (overAvailable(request) || overMaximum(index, request))
+            {
+                apply(index, request, -1);
+                continue;
+            }
+            admitted.push_back(r);
+        }
+
+        /* Find the longest safe run of admitted requests. The first applied ones are granted,
+           and safe is a run known to be safe, starting from the empty one. */
+        if (policy == AVOIDANCE)
+        {
+            int applied = admitted.size();
+            int safe = 0, unsafe = admitted.size() + 1;
+            while (unsafe - safe > 1)
+            {
+                int mid = (safe + unsafe) / 2;
+                for (; applied > mid; applied--)
+                    apply(requests[admitted[applied - 1]].first, requests[admitted[applied - 1]].second, -1);
+                for (; applied < mid; applied++)
+                    apply(requests[admitted[applied]].first, requests[admitted[applied]].second, 1);
+                if (isSafe(available, allocation))
+                    safe = mid;
+                else
+                    unsafe = mid;
+            }
+            for (; applied > safe; applied--)
+                apply(requests[admitted[applied - 1]].first, requests[admitted[applied - 1]].second, -1);
+            admitted.resize(safe);
+        }
+
+        for (int r : admitted)
+        {
+            granted[r] = true;
+        }
+        for (size_t r = 0; r < requests.size(); r++)
+        {
+            if (granted[r])
+                waiting[requests[r].first].clear();
+            else
+                waiting[requests[r].first] = requests[r].second;
+        }
+        stats.requests += requests.size();
+        stats.granted += admitted.size();
+        lockstatUnlock(&lock);
+        return granted;
+    }
+
+private:
+    int k;                          /* Number of tool types */
+    int n;                          /* Number of philosophers */
+    DeadlockPolicy policy;          /* Avoid deadlocks, or detect and break them */
+    vector<int> available;          /* Tools of each type not allocated to anyone */
+    vector<vector<int>> maximum;    /* Tools of each type each philosopher may ask for */
+    vector<vector<int>> allocation; /* Tools of each type each philosopher holds */
+    vector<ToolRequest> waiting;    /* Request each philosopher was last denied, until it is granted something */
+    vector<bool> preempted;         /* Philosophers rolled back by detect() that have not noticed yet */
+    ManagerStats stats;             /* Counters of requests, grants and rollbacks */
+    vector<int> safeSequence;       /* Order the philosophers could finish in, from the last safe state found */
+    vector<uint64_t> finish;        /* Bitset of philosophers finished in the current safety pass, reused between passes */
+    struct LockStat lock;           /* Lock for the structures above */
+
+    /* Calculate need structure for banker's algorithm */
+    vector<vector<int>> calculateNeed(vector<vector<int>> &m, vector<vector<int>> &a)
+    {
+        vector<vector<int>> need = vector<vector<int>>(n, vector<int>(k, 0));
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < k; j++)
+            {
+                need[i][j] = m[i][j] - a[i][j];
+            }
+        }
+
+        return need;
+    }
+
+    // Returns true if arr1 is less than or equal to arr2 for every item
+    static bool lteq(const vector<int> &arr1, const vector<int> &arr2)
+    {
+        for (size_t i = 0; i < arr1.size(); i++)
+        {
+            if (arr1[i] > arr2[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Returns the number of tools in a request
+    static int total(const ToolRequest &request)
+    {
+        int tools = 0;
+        for (auto &entry : request)
+        {
+            tools += entry.second;
+        }
+        return tools;
+    }
+
+    /* Adds sign times each entry of the request to counts */
+    static void apply(vector<int> &counts, const ToolRequest &request, int sign)
+    {
+        for (auto &entry : request)
+        {
+            counts[entry.first] += sign * entry.second;
+        }
+    }
+
+    /* Moves the request from available to the philosopher's allocation, or back when sign is -1. Must hold the lock. */
+    void apply(int index, const ToolRequest &request, int sign)
+    {
+        for (auto &entry : request)
+        {
+            allocation[index][entry.first] += sign * entry.second;
+            available[entry.first] -= sign * entry.second;
+        }
+    }
+
+    /* Returns if the philosopher holds more of a requested tool than it declared. Must hold the lock. */
+    bool overMaximum(int index, const ToolRequest &request)
+    {
+        for (auto &entry : request)
+        {
+            if (allocation[index][entry.first] > maximum[index][entry.first])
+                return true;
+        }
+        return false;
+    }
+
+    /* Returns if more of a requested tool is handed out than the pool has. Must hold the lock. */
+    bool overAvailable(const ToolRequest &request)
+    {
+        for (auto &entry : request)
+        {
+            if (available[entry.first] < 0)
+                return true;
+        }
+        return false;
+    }
+
+    /* Grants the request if it can be granted now. The request is applied in place and
+       taken back if it does not fit, so this costs O(tools in the request) before the
+       safety check. Must hold the lock. */
+    bool admit(int index, const ToolRequest &request)
+    {
+        apply(index, request, 1);
+
+        /* Throws error if philosopher requests more than he would need */
+        if (overMaximum(index, request))
+        {
+            apply(index, request, -1);
+            throw overflow_error("Exceeded maximum allowed");
+        }
+
+        /* Returns false if there are not enough resources available, or if the request will cause an unsafe state.
+           Detection mode skips the safety check and lets detect() clean up any deadlock. */
+        if (overAvailable(request) || (policy == AVOIDANCE && !isSafe(available, allocation)))
+        {
+            apply(index, request, -1);
+            return false;
+        }
+        return true;
+    }
+
+    /*
+        Check if the state with the given available tools and allocation is safe.
+        A grant or release rarely changes which order the philosophers can finish in,
+        so the cached safe sequence is replayed first, which costs O(n*k). The full
+        search only runs when the cached sequence no longer works.
+    */
+    bool isSafe(const vector<int> &available, const vector<vector<int>> &allocation)
+    {
+        if (replay(available, allocation))
+            return true;
+        vector<int> sequence;
+        bool safe = safety(available, allocation, sequence);
+        if (safe && (int)sequence.size() == n)
+            safeSequence = sequence;
+        return safe;
+    }
+
+    /* Returns true if every philosopher can finish in the order of the cached safe sequence */
+    bool replay(vector<int> available, const vector<vector<int>> &allocation)
+    {
+        if ((int)safeSequence.size() != n)
+            return false;
+        for (int i : safeSequence)
+        {
+            for (int j = 0; j < k; j++)
+            {
+                if (maximum[i][j] - allocation[i][j] > available[j])
+                    return false;
+            }
+            for (int j = 0; j < k; j++)
+            {
+                available[j] += allocation[i][j];
+            }
+        }
+        return true;
+    }
+
+    /* Returns the first philosopher at or after i that has not finished in the current safety pass, or n if there is none */
+    int nextUnfinished(int i)
+    {
+        for (int w = i / 64; i < n; w++, i = w * 64)
+        {
+            uint64_t open = ~finish[w] & (~0ULL << (i % 64));
+            if (open)
+                return min(n, w * 64 + __builtin_ctzll(open));
+        }
+        return n;
+    }
+
+    /* Check if the state with the given available tools and allocation is safe, recording the order philosophers finish in */
+    bool safety(vector<int> available, vector<vector<int>> allocation, vector<int> &sequence)
+    {
+        vector<vector<int>> need = calculateNeed(maximum, allocation);
+
+        finish.assign((n + 63) / 64, 0);
+
+        /* Sweep over the philosophers that have not finished, finishing every one that can
+           with the available resources, and repeat until a sweep finishes nobody */
+        bool progress = true;
+        while (progress)
+        {
+            progress = false;
+            for (int i = nextUnfinished(0); i < n; i = nextUnfinished(i + 1))
+            {
+                if (lteq(need[i], available))
+                {
+                    for (int j = 0; j < k; j++)
+                    {
+                        available[j] = available[j] + allocation[i][j];
+                    }
+                    finish[i / 64] |= 1ULL << (i % 64);
+                    sequence.push_back(i);
+                    progress = true;
+                }
+            }
+        }
+
+        /* If all philosophers cannot finish, the state is unsafe */
+        for (size_t w = 0; w < finish.size(); w++)
+        {
+            uint64_t all = w == finish.size() - 1 && n % 64 ? (1ULL << (n % 64)) - 1 : ~0ULL;
+            if (finish[w] != all)
+                return false;
+        }
+
+        /* Otherwise, the state is safe */
+        return true;
+    }
+};
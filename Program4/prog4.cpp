@@ -1,9 +1,29 @@
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include <cmath>
+#include <cassert>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <unistd.h>
 #include <vector>
 #include <deque>
 
 #include "prog4_lru.h"
 #include "prog4_2nd.h"
+#include "prog4_opt.h"
+#include "prog4_arc.h"
+#include "prog4_2q.h"
+#include "prog4_lfu.h"
+#include "prog4_mrc.h"
+#include "prog4_ws.h"
+#include "prog4_pff.h"
+#include "prog4_tlb.h"
+#include "prog4_esc.h"
+#include "prog4_prefetch.h"
 //
 //	Uncomment the following lines to test your program
 //  #include "prog4_lru.h"
@@ -118,8 +138,560 @@ int Page_Replacement(vector<int> &pages, int nextpage, PRDS_FIFO *p)
    int Page_Replacement_MyOwn(vector<int>& pages, int nextpage, PRDS_MyOwn* p) {}
 
 */
-int main()
+/*
+	TLB put in front of Simulate() runs, off unless tlbEntries is above 0, and the latencies used to
+	work out the effective access time
+*/
+int tlbEntries = 0;
+int tlbWays = 4;
+string tlbReplacement = "LRU";
+double tlbNs = 1;			  // TLB lookup
+double memoryNs = 100;		  // Memory access, also paid once more for the page table on a TLB miss
+double faultNs = 8000000;	  // Servicing a page fault
+double writeNs = 8000000;	  // Writing back one page, or one batch of pages for the flush daemon
+
+/*
+	Flush daemon, off unless flushPeriod is above 0. Every flushPeriod references it writes back up
+	to flushBatch dirty pages in one batch, so fewer evictions have to wait for a write-back.
+*/
+int flushPeriod = 0;
+int flushBatch = 16;
+
+/*
+	Prefetcher put in front of Simulate() runs, off unless prefetchDegree is above 0
+*/
+string prefetchKind = "next";
+int prefetchDegree = 0;
+
+/*
+	A fixed allocation policy bound to its data structure. Takes the pages vector, the next page, the
+	dirty bit of every slot and whether the page is prefetched rather than referenced, and answers
+	like the Page_Replacement functions. Only policies that prefer clean victims look at the dirty
+	bits, and only OPT, which follows the trace, needs to know about prefetches.
+*/
+typedef function<int(vector<int> &, int, const vector<bool> &, bool)> Policy;
+
+template <class PRDS>
+Policy Bind(PRDS *p, int (*replace)(vector<int> &, int, PRDS *))
+{
+	return [p, replace](vector<int> &pages, int nextpage, const vector<bool> &, bool)
+	{ return replace(pages, nextpage, p); };
+}
+
+/*
+	Makes the named fixed allocation policy for count pages, or returns an empty Policy if there is
+	no such policy. OPT is given the trace it will see.
+*/
+Policy MakePolicy(string policy, int count, vector<int> &pagelist)
 {
+	if (policy == "FIFO")
+		return Bind(new PRDS_FIFO(count), Page_Replacement);
+	if (policy == "LRU")
+		return Bind(new PRDS_LRU(count), Page_Replacement_LRU);
+	if (policy == "2nd")
+		return Bind(new PRDS_2nd(count), Page_Replacement_2nd);
+	if (policy == "OPT")
+	{
+		PRDS_OPT *p = new PRDS_OPT(count, pagelist);
+		return [p](vector<int> &pages, int nextpage, const vector<bool> &, bool prefetch)
+		{ return Page_Replacement_OPT(pages, nextpage, p, prefetch); };
+	}
+	if (policy == "ARC")
+		return Bind(new PRDS_ARC(count), Page_Replacement_ARC);
+	if (policy == "2Q")
+		return Bind(new PRDS_2Q(count), Page_Replacement_2Q);
+	if (policy == "LFU" || policy.rfind("LFU:", 0) == 0)
+		return Bind(new PRDS_LFU(count, policy == "LFU" ? 0 : atoi(policy.c_str() + 4)), Page_Replacement_LFU);
+	if (policy == "ESC")
+	{
+		PRDS_ESC *p = new PRDS_ESC(count);
+		return [p](vector<int> &pages, int nextpage, const vector<bool> &dirty, bool)
+		{ return Page_Replacement_ESC(pages, nextpage, p, dirty); };
+	}
+	return Policy();
+}
+
+/*
+	Runs one policy over a trace, printing each reference the same way as the testresult files
+	unless quiet, followed by the page replaced count. When quiet, also prints the time the policy
+	took per reference. With the TLB on, also prints the TLB hit rate, the fault rate and the
+	effective access time. If writes is not empty, it says which references are writes, and the
+	write-backs and time spent on I/O are printed as well. With the prefetcher on, the page replaced
+	count only counts misses, and how many prefetched pages were used or evicted unused is printed
+	as well. Returns the page replaced count.
+*/
+int Simulate(string name, string file, vector<int> &pagelist, vector<bool> &writes, int count, Policy replace, bool quiet)
+{
+	vector<int> pages(count, -1);
+	int replace_count = 0;
+	TLB *tlb = tlbEntries > 0 ? new TLB(tlbEntries, tlbWays, tlbReplacement) : NULL;
+	Prefetcher *prefetcher = prefetchDegree > 0 ? new Prefetcher(prefetchKind, prefetchDegree) : NULL;
+	bool track = !writes.empty() || prefetcher != NULL;
+	vector<bool> dirty(count, false);
+	vector<bool> speculative(count, false); // Slots holding a prefetched page not used yet
+	unordered_map<int, int> slots;			// Slot of every page in memory, only kept when writes or prefetches need it
+	long writebacks = 0, flushed = 0, batches = 0;
+	long prefetched = 0, useful = 0, polluting = 0;
+	int flushHand = 0;
+	auto start = chrono::steady_clock::now();
+
+	/* Puts page in slot res, accounting for the page it replaces. FIFO writes the page into an
+	   empty slot itself, so finding the page already there means nothing was replaced. */
+	auto load = [&](int res, int page)
+	{
+		int victim = pages[res] == page ? -1 : pages[res];
+		if (victim != -1)
+		{
+			if (tlb != NULL)
+				tlb->shootdown(victim);
+			if (dirty[res]) // The victim has to be written back before its slot can be used
+				writebacks++;
+			if (speculative[res]) // Prefetched for nothing, and took the place of another page
+				polluting++;
+		}
+		if (track)
+		{
+			slots.erase(victim);
+			slots[page] = res;
+		}
+		dirty[res] = false;
+		speculative[res] = false;
+		pages[res] = page;
+	};
+
+	for (int i = 0; i < (int)pagelist.size(); i++)
+	{
+		if (tlb != NULL)
+			tlb->lookup(pagelist[i]);
+		int res = replace(pages, pagelist[i], dirty, false);
+		int slot = res;
+		bool trigger = res > -1;
+		if (res > -1)
+		{
+			replace_count++;
+			load(res, pagelist[i]);
+		}
+		else if (track)
+		{
+			slot = slots[pagelist[i]];
+			if (speculative[slot]) // First use of a prefetched page
+			{
+				useful++;
+				speculative[slot] = false;
+				trigger = true;
+			}
+		}
+		if (!writes.empty() && writes[i])
+			dirty[slot] = true;
+
+		/* Bring in the pages the prefetcher expects, through the policy like any other page */
+		if (prefetcher != NULL && trigger)
+		{
+			for (int page : prefetcher->predict(pagelist[i]))
+			{
+				if (page < 0 || slots.count(page) > 0)
+					continue;
+				int at = replace(pages, page, dirty, true);
+				if (at < 0)
+					continue;
+				load(at, page);
+				speculative[at] = true;
+				prefetched++;
+			}
+		}
+
+		/* The flush daemon cleans the next dirty pages after the one it stopped at */
+		if (flushPeriod > 0 && (i + 1) % flushPeriod == 0)
+		{
+			int cleaned = 0;
+			for (int j = 0; j < count && cleaned < flushBatch; j++, flushHand = (flushHand + 1) % count)
+			{
+				if (dirty[flushHand])
+				{
+					dirty[flushHand] = false;
+					cleaned++;
+				}
+			}
+			flushed += cleaned;
+			batches += cleaned > 0;
+		}
+		if (quiet)
+			continue;
+		cout << name << " " << file << " " << count << " | " << pagelist[i] << "  " << res << "  :  ";
+		for (int j = 0; j < (int)pages.size(); j++)
+			cout << pages[j] << " ";
+		cout << endl;
+	}
+	cout << file << " " << count << "  Page replaced count " << name << " : " << replace_count << endl;
+	if (quiet && pagelist.size() > 0)
+	{
+		double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+		cout << file << " " << count << "  ns per reference " << name << " : " << ns / pagelist.size() << endl;
+	}
+	if (tlb != NULL && pagelist.size() > 0)
+	{
+		double n = pagelist.size();
+		double eat = tlbNs + memoryNs + tlb->misses / n * memoryNs + replace_count / n * faultNs;
+		cout << file << " " << count << "  TLB hit rate " << name << " : " << tlb->hits / n
+			 << "  fault rate : " << replace_count / n << "  shootdowns : " << tlb->shootdowns
+			 << "  effective access time : " << eat << " ns" << endl;
+		delete tlb;
+	}
+	if (!writes.empty())
+		cout << file << " " << count << "  Write-backs " << name << " : " << writebacks << "  flushed : " << flushed
+			 << " in " << batches << " batches  I/O time : "
+			 << (replace_count * faultNs + (writebacks + batches) * writeNs) / 1000000 << " ms" << endl;
+	if (prefetcher != NULL)
+	{
+		cout << file << " " << count << "  Prefetched " << name << " : " << prefetched << "  used : " << useful
+			 << "  accuracy : " << (prefetched ? (double)useful / prefetched : 0.0)
+			 << "  evicted unused : " << polluting << endl;
+		delete prefetcher;
+	}
+	return replace_count;
+}
+
+/*
+	Runs a variable allocation policy over a trace, starting with no pages in memory. Prints each
+	reference like Simulate() unless quiet, followed by the page replaced count, the average number
+	of pages in memory and the fault rate. param is the window or interval the policy was made with.
+	Returns the page replaced count.
+*/
+template <class PRDS>
+int SimulateVariable(string name, string file, vector<int> &pagelist, int param, PRDS *p,
+					 int (*replace)(vector<int> &, int, PRDS *), bool quiet)
+{
+	vector<int> pages;
+	int replace_count = 0;
+	double resident = 0;
+
+	for (int i = 0; i < (int)pagelist.size(); i++)
+	{
+		int res = replace(pages, pagelist[i], p);
+		if (res > -1)
+		{
+			replace_count++;
+			pages[res] = pagelist[i];
+		}
+		resident += p->resident();
+		if (quiet)
+			continue;
+		cout << name << " " << file << " " << param << " | " << pagelist[i] << "  " << res << "  :  ";
+		for (int j = 0; j < (int)pages.size(); j++)
+			cout << pages[j] << " ";
+		cout << endl;
+	}
+	cout << file << " " << param << "  Page replaced count " << name << " : " << replace_count << endl;
+	if (pagelist.size() > 0)
+		cout << file << " " << param << "  Average resident " << name << " : " << resident / pagelist.size()
+			 << "  fault rate : " << (double)replace_count / pagelist.size() << endl;
+	return replace_count;
+}
+
+/*
+	Prints the LRU miss ratio curve of the trace for every memory size up to count. With a sampling
+	rate below 1, prints the exact curve next to the sampled one and how far apart they are, both
+	over all sizes and over the sizes of at least 1 / rate pages, below which sampled distances
+	are too coarse to mean much.
+*/
+void MissRatioCurve(string file, vector<int> &pagelist, int count, double rate, int maxSamples)
+{
+	MRC_LRU exact(count);
+	MRC_LRU sampled(count, rate, maxSamples);
+	for (int i = 0; i < (int)pagelist.size(); i++)
+	{
+		exact.access(pagelist[i]);
+		if (rate < 1.0)
+			sampled.access(pagelist[i]);
+	}
+
+	vector<double> exactCurve = exact.curve();
+	vector<double> sampledCurve = rate < 1.0 ? sampled.curve() : exactCurve;
+	double maxError = 0, totalError = 0, maxResolved = 0;
+	for (int size = 1; size <= count; size++)
+	{
+		double error = abs(sampledCurve[size - 1] - exactCurve[size - 1]);
+		maxError = max(maxError, error);
+		totalError += error;
+		if (size * rate >= 1.0)
+			maxResolved = max(maxResolved, error);
+		cout << file << " " << size << "  Miss ratio LRU : " << exactCurve[size - 1];
+		if (rate < 1.0)
+			cout << "  sampled : " << sampledCurve[size - 1] << "  error : " << error;
+		cout << endl;
+	}
+	if (rate < 1.0)
+		cout << file << "  Sampled " << sampled.followedPages() << " of " << exact.followedPages() << " pages at rate " << rate
+			 << "  max error : " << maxError << "  mean error : " << totalError / count
+			 << "  max error from " << (int)ceil(1.0 / rate) << " pages : " << maxResolved << endl;
+}
+
+/*
+	Runs a multi-process trace with the policy either shared by all processes over one pool of count
+	pages (global), or split into one policy per process over an equal share of the pages (local).
+	pids holds the process of each reference. Prints the page replaced count of every process unless
+	quiet, then the total and how evenly the fault rates are spread, by Jain's fairness index (1 when
+	every process faults at the same rate, 1 / processes when one takes all the faults).
+	Returns the total page replaced count, -1 if there is no such policy, or -2 if there are fewer
+	pages than processes to split them between.
+*/
+int MultiProcess(bool global, string policy, string file, vector<int> &pagelist, vector<int> &pids, int count, bool quiet)
+{
+	/* Number the processes in order of first reference */
+	unordered_map<int, int> process;
+	vector<int> owner(pagelist.size());
+	vector<int> processes;
+	for (int i = 0; i < (int)pagelist.size(); i++)
+	{
+		auto found = process.find(pids[i]);
+		if (found == process.end())
+		{
+			found = process.insert(make_pair(pids[i], (int)processes.size())).first;
+			processes.push_back(pids[i]);
+		}
+		owner[i] = found->second;
+	}
+	int p = processes.size();
+	if (!global && count < p)
+	{
+		cout << "ERROR: " << count << " pages cannot be split between " << p << " processes" << endl;
+		return -2;
+	}
+
+	/* One policy over everything, or one per process over its own references */
+	vector<Policy> replace;
+	vector<vector<int>> pages;
+	vector<vector<bool>> dirty; // Never set, writes are not modelled across processes
+	if (global)
+	{
+		replace.push_back(MakePolicy(policy, count, pagelist));
+		pages.push_back(vector<int>(count, -1));
+		dirty.push_back(vector<bool>(count, false));
+	}
+	else
+	{
+		vector<vector<int>> own(p);
+		for (int i = 0; i < (int)pagelist.size(); i++)
+			own[owner[i]].push_back(pagelist[i]);
+		for (int j = 0; j < p; j++)
+		{
+			int share = count / p + (j < count % p); // The pages left over go to the first processes
+			replace.push_back(MakePolicy(policy, share, own[j]));
+			pages.push_back(vector<int>(share, -1));
+			dirty.push_back(vector<bool>(share, false));
+		}
+	}
+	if (!replace[0])
+		return -1;
+
+	vector<long> references(p, 0);
+	vector<long> faults(p, 0);
+	for (int i = 0; i < (int)pagelist.size(); i++)
+	{
+		int j = owner[i];
+		int k = global ? 0 : j;
+		int res = replace[k](pages[k], pagelist[i], dirty[k], false);
+		if (res > -1)
+		{
+			faults[j]++;
+			pages[k][res] = pagelist[i];
+		}
+		references[j]++;
+	}
+
+	string name = (global ? "global:" : "local:") + policy;
+	long replace_count = 0;
+	double sum = 0, squares = 0;
+	for (int j = 0; j < p; j++)
+	{
+		double rate = (double)faults[j] / references[j];
+		replace_count += faults[j];
+		sum += rate;
+		squares += rate * rate;
+		if (!quiet)
+			cout << file << " " << count << "  Process " << processes[j] << "  Page replaced count " << name << " : "
+				 << faults[j] << "  of " << references[j] << "  fault rate : " << rate << endl;
+	}
+	cout << file << " " << count << "  Page replaced count " << name << " : " << replace_count << endl;
+	cout << file << " " << count << "  Fairness " << name << " : " << (squares > 0 ? sum * sum / (p * squares) : 1.0)
+		 << "  over " << p << " processes" << endl;
+	return replace_count;
+}
+
+/*
+	Runs the named policy over the trace and returns its page replaced count, -1 if there is no
+	such policy, or -2 if its parameters are invalid, after printing why. "all" runs every policy and reports how far each one is from optimal, which
+	none of them can beat without a prefetcher.
+*/
+int Run(string policy, string file, vector<int> &pagelist, vector<int> &pids, vector<bool> &writes, int count, bool quiet)
+{
+	Policy replace = MakePolicy(policy, count, pagelist);
+	if (replace)
+		return Simulate(policy, file, pagelist, writes, count, replace, quiet);
+	if (policy == "WS")
+		return SimulateVariable("WS", file, pagelist, count, new PRDS_WS(count), Page_Replacement_WS, quiet);
+	if (policy == "PFF")
+		return SimulateVariable("PFF", file, pagelist, count, new PRDS_PFF(count), Page_Replacement_PFF, quiet);
+	if (policy == "MRC" || policy.rfind("MRC:", 0) == 0)
+	{
+		double rate = 1.0;
+		int maxSamples = 0;
+		int used = 0;
+		int fields = sscanf(policy.c_str(), "MRC:%lf%n:%d%n", &rate, &used, &maxSamples, &used);
+		if (policy != "MRC" && (fields < 1 || used != (int)policy.size()))
+		{
+			cout << "ERROR: Bad MRC policy " << policy << ", expected MRC:<rate>[:<max pages followed>]" << endl;
+			return -2;
+		}
+		if (!(rate > 0 && rate <= 1) || maxSamples < 0)
+		{
+			cout << "ERROR: MRC sampling rate must be in (0, 1] and max pages followed >= 0" << endl;
+			return -2;
+		}
+		MissRatioCurve(file, pagelist, count, rate, maxSamples);
+		return 0;
+	}
+	if (policy.rfind("global:", 0) == 0)
+		return MultiProcess(true, policy.substr(7), file, pagelist, pids, count, quiet);
+	if (policy.rfind("local:", 0) == 0)
+		return MultiProcess(false, policy.substr(6), file, pagelist, pids, count, quiet);
+	if (policy != "all")
+		return -1;
+
+	int optimal = Run("OPT", file, pagelist, pids, writes, count, true);
+	for (string other : {"FIFO", "LRU", "2nd", "ARC", "2Q", "LFU", "ESC"})
+	{
+		int replaced = Run(other, file, pagelist, pids, writes, count, true);
+		assert(prefetchDegree > 0 || replaced >= optimal); // Nothing beats OPT, unless prefetching changes what it decides on
+		cout << "    " << other << " is " << replaced - optimal << " replacements ("
+			 << (optimal ? 100.0 * (replaced - optimal) / optimal : 0.0) << "%) above OPT" << endl;
+	}
+	return optimal;
+}
+
+/*
+	Usage: prog4 [-q] [-t entries,ways,LRU|FIFO|random] [-l tlb,memory,fault[,write] ns] [-f period,batch]
+				 [-p next|stride|history,degree] <policy> <trace file> <number of pages>
+
+	The trace file holds the number of references followed by the references, one per line. A
+	reference may be tagged with a process as "<pid> <page>", in which case the pages of different
+	processes are told apart and numbered in order of first use, and may end in w for a write or r
+	for a read. The policy is
+	FIFO, LRU, 2nd, ARC, 2Q, LFU, ESC (enhanced second chance), OPT or all, and LFU:<n> is LFU with every use count halved
+	every n references. -q only prints the page replaced counts.
+
+	Policies WS (working set) and PFF (page fault frequency) vary the number of pages in memory
+	instead. For WS the number given is the window in references, for PFF the number of references
+	between faults above which memory shrinks.
+
+	Policy MRC prints the LRU miss ratio of every memory size up to the number of pages instead.
+	MRC:<rate>[:<max pages followed>] estimates it from a sample of the pages and compares it with
+	the exact curve.
+
+	global:<policy> and local:<policy> run any fixed allocation policy over a tagged trace, either
+	with one pool of pages shared by every process or with the pages split evenly between them,
+	and report the faults of every process and how fairly they are spread.
+	-t puts a set-associative TLB in front of the policy, and -l sets the latencies used for the
+	effective access time (1, 100 and 8000000 ns by default), and optionally a page write-back
+	(8000000 ns by default). -f runs a flush daemon that writes back up to batch dirty pages,
+	with a single write-back's latency, every period references. -p puts a prefetcher of the given
+	kind in front of the policy, which brings in up to degree pages after every miss and every
+	first use of a page it brought in.
+
+	Without arguments, runs LRU over 20 random references.
+*/
+int main(int argc, char *argv[])
+{
+	if (argc > 1)
+	{
+		bool quiet = false;
+		bool usage = false;
+		int opt;
+		char replacement[16];
+		while ((opt = getopt(argc, argv, "qt:l:f:p:")) != -1)
+		{
+			switch (opt)
+			{
+			case 'q':
+				quiet = true;
+				break;
+			case 't':
+				if (sscanf(optarg, "%d,%d,%15s", &tlbEntries, &tlbWays, replacement) == 3)
+					tlbReplacement = replacement;
+				usage |= tlbEntries < 1 || tlbWays < 1 ||
+						 (tlbReplacement != "LRU" && tlbReplacement != "FIFO" && tlbReplacement != "random");
+				break;
+			case 'l':
+				usage |= sscanf(optarg, "%lf,%lf,%lf,%lf", &tlbNs, &memoryNs, &faultNs, &writeNs) < 3;
+				break;
+			case 'p':
+				if (sscanf(optarg, "%15[^,],%d", replacement, &prefetchDegree) == 2)
+					prefetchKind = replacement;
+				usage |= prefetchDegree < 1 || (prefetchKind != "next" && prefetchKind != "stride" && prefetchKind != "history");
+				break;
+			case 'f':
+				usage |= sscanf(optarg, "%d,%d", &flushPeriod, &flushBatch) != 2 || flushPeriod < 1 || flushBatch < 1;
+				break;
+			default:
+				usage = true;
+			}
+		}
+		if (usage || argc - optind != 3)
+		{
+			cout << "Usage: " << argv[0] << " [-q] [-t entries,ways,LRU|FIFO|random] [-l tlb,memory,fault[,write] ns] [-f period,batch]"
+				 << " [-p next|stride|history,degree]"
+				 << " <policy> <trace file> <number of pages>" << endl;
+			return -1;
+		}
+		string policy = argv[optind];
+		string file = argv[optind + 1];
+		int count = atoi(argv[optind + 2]);
+
+		ifstream input(file);
+		int n;
+		if (!(input >> n) || count < 1)
+		{
+			cout << "ERROR: Cannot read " << file << " or number of pages is < 1" << endl;
+			return -1;
+		}
+		/* Pages tagged with a process are looked up by (pid, page), so every process has its own pages */
+		vector<int> pagelist(n);
+		vector<int> pids(n, 0);
+		vector<bool> writes(n, false);
+		bool anyWrites = false;
+		unordered_map<uint64_t, int> tagged;
+		string line;
+		getline(input, line);
+		for (int i = 0; i < n && getline(input, line);)
+		{
+			int pid, page;
+			int fields = sscanf(line.c_str(), "%d %d", &pid, &page);
+			if (fields >= 1 && line.find_first_of("wW") != string::npos)
+			{
+				writes[i] = true;
+				anyWrites = true;
+			}
+			if (fields == 1)
+			{
+				pagelist[i++] = pid;
+			}
+			else if (fields == 2)
+			{
+				uint64_t key = (uint64_t)(uint32_t)pid << 32 | (uint32_t)page;
+				auto found = tagged.insert(make_pair(key, (int)tagged.size())).first;
+				pids[i] = pid;
+				pagelist[i++] = found->second;
+			}
+		}
+		if (!anyWrites)
+			writes.clear();
+
+		int replaced = Run(policy, file, pagelist, pids, writes, count, quiet);
+		if (replaced == -1)
+			cout << "ERROR: Unknown policy " << policy << endl;
+		return replaced < 0 ? -1 : 0;
+	}
+
 	int count = 3;
 	vector<int> pagelist;
 	vector<int> pages;
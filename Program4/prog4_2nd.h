@@ -29,8 +29,6 @@ public:
             }
         }
 
-        pages.push_back(make_pair(page, 0)); // Add new page to the back of the queue
-
         // Remove element at the front of the queue and check if it has a "chance" counter at 0
         auto victim = pages.front();
         pages.pop_front();
@@ -44,6 +42,8 @@ public:
             pages.pop_front();
         }
 
+        pages.push_back(make_pair(page, 0)); // Add new page to the back of the queue once the victim is out, so it is never its own victim
+
         // Return the value of the victim to be replaced
         return victim.first;
     }
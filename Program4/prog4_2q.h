@@ -0,0 +1,101 @@
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+class PRDS_2Q
+{
+public:
+    // Sets the max number of pages in main memory. A1in holds a quarter of them, A1out remembers half as many.
+    PRDS_2Q(int pages)
+    {
+        max = pages;
+        maxIn = std::max(1, pages / 4);
+        maxOut = std::max(1, pages / 2);
+    }
+
+    // 2Q. A page seen for the first time goes to the FIFO queue A1in, and only a page seen again after
+    // leaving A1in, while it is still remembered in A1out, is promoted to the LRU queue Am.
+    // A scan therefore only cycles through A1in and never flushes the pages in Am.
+    // Every queue operation is O(1), found through one hash table of the pages in any of the queues.
+    // result == -1: Do not replace anything
+    //        >=  0: Replace the page in slot <result>
+    int replaceWith(int page)
+    {
+        auto found = entries.find(page);
+        if (found != entries.end() && found->second.where == Am) // Hit in Am, the page moves to the MRU end
+        {
+            queues[Am].splice(queues[Am].end(), queues[Am], found->second.it);
+            return -1;
+        }
+        if (found != entries.end() && found->second.where == A1in) // Hit in A1in, left where it is
+            return -1;
+
+        int where = A1in;
+        if (found != entries.end()) // Remembered in A1out, so it is promoted to Am
+        {
+            queues[A1out].erase(found->second.it);
+            entries.erase(found);
+            where = Am;
+        }
+        int slot = reclaim();
+        queues[where].push_back(page);
+        entries[page] = {where, prev(queues[where].end()), slot};
+        return slot;
+    }
+
+private:
+    enum Queue
+    {
+        A1in,  // Resident, seen once, FIFO
+        A1out, // Evicted from A1in, FIFO
+        Am     // Resident, seen again, LRU
+    };
+    struct Entry
+    {
+        int where;              // Queue the page is in
+        list<int>::iterator it; // Position of the page in that queue
+        int slot;               // Index in the pages vector if the page is resident
+    };
+
+    int max;
+    int maxIn;                         // Size A1in may grow to before it gives up pages
+    int maxOut;                        // Pages remembered in A1out
+    list<int> queues[3];               // Oldest or LRU at the front
+    unordered_map<int, Entry> entries; // Every page in any of the queues
+
+    // Returns a free slot, evicting a page if memory is full
+    int reclaim()
+    {
+        int resident = queues[A1in].size() + queues[Am].size();
+        if (resident < max)
+            return resident;
+
+        if ((int)queues[A1in].size() > maxIn || queues[Am].empty()) // A1in is over its share, its oldest page moves to A1out
+        {
+            int victim = queues[A1in].front();
+            Entry &e = entries[victim];
+            queues[A1out].splice(queues[A1out].end(), queues[A1in], e.it);
+            e.where = A1out;
+            if ((int)queues[A1out].size() > maxOut)
+            {
+                entries.erase(queues[A1out].front());
+                queues[A1out].pop_front();
+            }
+            return e.slot;
+        }
+
+        int victim = queues[Am].front(); // Otherwise the LRU page of Am is evicted and forgotten
+        int slot = entries[victim].slot;
+        entries.erase(victim);
+        queues[Am].pop_front();
+        return slot;
+    }
+};
+
+int Page_Replacement_2Q(vector<int> & /* pages */, int nextpage, PRDS_2Q *p)
+{
+    return p->replaceWith(nextpage); // The data structure already knows which slot each page is in
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+
+class PRDS_ARC
+{
+public:
+    PRDS_ARC(int pages) { max = pages; } // Sets the max number of pages in main memory
+
+    // Adaptive Replacement Cache. Pages seen once live in T1 and pages seen again in T2, both in LRU order.
+    // B1 and B2 remember pages recently evicted from each, and a hit in either moves the target size of T1.
+    // A scan only ever passes through T1, so it cannot flush the pages in T2.
+    // Every list operation is O(1), found through one hash table of the pages in any of the lists.
+    // result == -1: Do not replace anything
+    //        >=  0: Replace the page in slot <result>
+    int replaceWith(int page)
+    {
+        auto found = entries.find(page);
+        if (found != entries.end() && found->second.where <= T2) // Case I: hit, the page moves to the MRU end of T2
+        {
+            move(page, T2);
+            return -1;
+        }
+
+        int slot;
+        if (found != entries.end() && found->second.where == B1) // Case II: recently evicted from T1, so T1 should grow
+        {
+            target = min(max, target + std::max(size(B2) / size(B1), 1));
+            slot = replace(false);
+            move(page, T2);
+        }
+        else if (found != entries.end() && found->second.where == B2) // Case III: recently evicted from T2, so T1 should shrink
+        {
+            target = std::max(0, target - std::max(size(B1) / size(B2), 1));
+            slot = replace(true);
+            move(page, T2);
+        }
+        else // Case IV: a page not seen recently goes to the MRU end of T1
+        {
+            if (size(T1) + size(B1) == max)
+            {
+                if (size(T1) < max)
+                {
+                    drop(B1);
+                    slot = replace(false);
+                }
+                else
+                {
+                    slot = entries[lists[T1].front()].slot;
+                    drop(T1);
+                }
+            }
+            else if (size(T1) + size(T2) < max) // Memory is not full, take the next empty slot
+            {
+                slot = size(T1) + size(T2);
+            }
+            else
+            {
+                if (size(T1) + size(T2) + size(B1) + size(B2) == 2 * max)
+                    drop(B2);
+                slot = replace(false);
+            }
+            lists[T1].push_back(page);
+            entries[page] = {T1, prev(lists[T1].end()), -1};
+        }
+        entries[page].slot = slot;
+        return slot;
+    }
+
+private:
+    enum List
+    {
+        T1, // Resident, seen once recently
+        T2, // Resident, seen at least twice recently
+        B1, // Evicted from T1
+        B2  // Evicted from T2
+    };
+    struct Entry
+    {
+        int where;               // List the page is in
+        list<int>::iterator it;  // Position of the page in that list
+        int slot;                // Index in the pages vector if the page is resident
+    };
+
+    int max;
+    int target = 0;                     // Target size of T1, adapted on every ghost hit
+    list<int> lists[4];                 // LRU at the front, MRU at the back
+    unordered_map<int, Entry> entries;  // Every page in any of the lists
+
+    int size(int l) { return lists[l].size(); }
+
+    // Moves a page from whichever list it is in to the MRU end of list l
+    void move(int page, int l)
+    {
+        Entry &e = entries[page];
+        lists[l].splice(lists[l].end(), lists[e.where], e.it);
+        e.where = l;
+    }
+
+    // Forgets the LRU page of list l
+    void drop(int l)
+    {
+        entries.erase(lists[l].front());
+        lists[l].pop_front();
+    }
+
+    // Evicts the LRU page of T1 or T2 into its ghost list, depending on the target size of T1.
+    // inB2 is whether the page being brought in was found in B2. Returns the slot freed.
+    int replace(bool inB2)
+    {
+        int from = size(T1) > 0 && (size(T1) > target || (inB2 && size(T1) == target)) ? T1 : T2;
+        int victim = lists[from].front();
+        move(victim, from == T1 ? B1 : B2);
+        return entries[victim].slot;
+    }
+};
+
+int Page_Replacement_ARC(vector<int> & /* pages */, int nextpage, PRDS_ARC *p)
+{
+    return p->replaceWith(nextpage); // The data structure already knows which slot each page is in
+}
\ No newline at end of file
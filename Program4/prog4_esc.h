@@ -0,0 +1,75 @@
+#include <vector>
+#include <unordered_map>
+
+using namespace std;
+
+class PRDS_ESC
+{
+public:
+    PRDS_ESC(int pages) // Sets the max number of pages in main memory
+    {
+        referenced = vector<bool>(pages, false);
+    }
+
+    // Enhanced second chance. The clock hand sweeps the slots looking for the best class of victim by
+    // (referenced, dirty) bits: first a page neither used nor written since the hand last passed,
+    // then one written but not used, clearing the referenced bit of every page it passes, then the
+    // same again. Clean pages are preferred because they can be dropped without a write-back.
+    // dirty holds the dirty bit of every slot, kept by the simulator.
+    // result == -1: Do not replace anything
+    //        >=  0: Replace the page in slot <result>
+    int replaceWith(int page, const vector<bool> &dirty)
+    {
+        auto found = slots.find(page);
+        if (found != slots.end()) // Hit, mark the page as referenced
+        {
+            referenced[found->second] = true;
+            return -1;
+        }
+
+        int slot;
+        if (slots.size() < referenced.size()) // If memory is not full, take the next empty slot
+        {
+            slot = slots.size();
+        }
+        else
+        {
+            slot = -1;
+            for (int pass = 0; pass < 4 && slot == -1; pass++)
+            {
+                bool wantDirty = pass % 2 == 1; // Passes 0 and 2 look for (0, 0), passes 1 and 3 for (0, 1)
+                for (int i = 0; i < (int)referenced.size(); i++)
+                {
+                    int at = hand;
+                    hand = (hand + 1) % referenced.size();
+                    if (!referenced[at] && dirty[at] == wantDirty)
+                    {
+                        slot = at;
+                        break;
+                    }
+                    if (wantDirty)
+                        referenced[at] = false;
+                }
+            }
+            slots.erase(owner[slot]);
+        }
+
+        if (slot >= (int)owner.size())
+            owner.resize(slot + 1);
+        owner[slot] = page;
+        slots[page] = slot;
+        referenced[slot] = true;
+        return slot;
+    }
+
+private:
+    int hand = 0;                   // Slot the clock hand points at
+    vector<bool> referenced;        // Referenced bit of every slot
+    vector<int> owner;              // Page in every slot
+    unordered_map<int, int> slots;  // Slot of every page in memory
+};
+
+int Page_Replacement_ESC(vector<int> & /* pages */, int nextpage, PRDS_ESC *p, const vector<bool> &dirty)
+{
+    return p->replaceWith(nextpage, dirty); // The data structure already knows which slot each page is in
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef PROG4_FRAMES_H
+#define PROG4_FRAMES_H
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <unordered_map>
+
+using namespace std;
+
+/*
+	Frame table for the variable allocation policies, where the pages vector grows and shrinks.
+	Remembers which slot every resident page is in, hands out the lowest free slot first, and
+	collects the slots freed during the current reference so the pages vector can be updated.
+*/
+class FrameTable
+{
+public:
+    // Returns the slot the page is in, or -1 if it is not in memory
+    int slotOf(int page)
+    {
+        auto found = slots.find(page);
+        return found == slots.end() ? -1 : found->second;
+    }
+
+    // Puts the page in the lowest free slot and returns the slot
+    int place(int page)
+    {
+        int slot;
+        if (free.empty())
+        {
+            slot = slots.size();
+        }
+        else
+        {
+            slot = free.top();
+            free.pop();
+        }
+        slots[page] = slot;
+        return slot;
+    }
+
+    // Takes the page out of memory
+    void evict(int page)
+    {
+        int slot = slots[page];
+        slots.erase(page);
+        free.push(slot);
+        released.push_back(slot);
+    }
+
+    int resident() { return slots.size(); }
+
+    vector<int> released; // Slots freed during the current reference
+
+private:
+    unordered_map<int, int> slots;                       // Slot of every page in memory
+    priority_queue<int, vector<int>, greater<int>> free; // Slots below the highest in use that are empty, lowest on top
+};
+
+// Applies a variable allocation policy's answer to the pages vector: empties the slots it freed,
+// and grows the vector if the new page goes past the end. Returns the slot to replace, or -1.
+template <class PRDS>
+int Page_Replacement_Variable(vector<int> &pages, int nextpage, PRDS *p)
+{
+    int slot = p->replaceWith(nextpage);
+    for (int freed : p->frames.released)
+        pages[freed] = -1;
+    if (slot >= (int)pages.size())
+        pages.resize(slot + 1, -1);
+    return slot;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+
+using namespace std;
+
+/*
+	Synthetic trace generator for prog4. Writes a trace in prog4's text format: the number of
+	references, then one reference per line, followed by " w" for a write.
+
+	Usage: prog4_gen [-s seed] [-j threads] [-b burst] [-w write ratio] [-o file] <references> <model>
+
+	A model is one of
+		zipf:<pages>:<alpha>                        Page k is used with probability proportional to 1 / k^alpha, alpha >= 0
+		phases:<pages>:<set size>:<phase length>    Uniform over a working set that moves every phase
+		scan:<pages>                                Sequential passes over the pages
+		loop:<pages>:<length>:<repeats>             A loop over length pages run repeats times, then
+		                                            over the next length pages, so it keeps coming
+		                                            back to a small range where scan moves on
+	or a mixture of them, such as 0.7*zipf:1000:0.9+0.3*scan:100000. Each model of a mixture gets
+	its own range of pages, and the model used is picked anew every burst references (1000 by
+	default), so scans and loops stay sequential within a burst.
+
+	The trace is cut into chunks that threads generate in parallel, each from a generator seeded by
+	the seed and the chunk number, so the same seed gives the same trace for any number of threads.
+*/
+
+#define CHUNK (1 << 20) /* References generated by a thread at a time */
+
+enum Kind
+{
+	ZIPF,
+	PHASES,
+	SCAN,
+	LOOP
+};
+
+struct Model
+{
+	Kind kind;
+	double weight;		 // Share of the bursts in a mixture
+	long pages;			 // Pages the model uses
+	long base;			 // First page of the model's range
+	double alpha;		 // Skew for zipf
+	long setSize;		 // Working set size for phases
+	long phaseLength;	 // References per phase for phases
+	long length;		 // Pages in the loop body for loop
+	long repeats;		 // Times each loop body runs for loop
+	vector<double> cdf;	 // Cumulative probability of every rank for zipf
+};
+
+vector<Model> models;
+uint64_t seed = 1;
+long burst = 1000;
+double writeRatio = 0;
+long references;
+
+/* splitmix64, used to seed generators and to hash positions */
+uint64_t Mix(uint64_t x)
+{
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/* xorshift64* generator */
+struct Rng
+{
+	uint64_t state;
+	uint64_t next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1DULL;
+	}
+	double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+/* Parses one model, returning false if it is malformed */
+bool ParseModel(string spec, double weight)
+{
+	Model m = {};
+	m.weight = weight;
+	if (sscanf(spec.c_str(), "zipf:%ld:%lf", &m.pages, &m.alpha) == 2)
+	{
+		m.kind = ZIPF;
+		if (m.pages < 1 || !(m.alpha >= 0) || isinf(m.alpha)) /* Checked before the cdf is sized from them */
+			return false;
+		m.cdf.resize(m.pages);
+		double total = 0;
+		for (long k = 0; k < m.pages; k++)
+		{
+			total += 1.0 / pow(k + 1, m.alpha);
+			m.cdf[k] = total;
+		}
+		for (long k = 0; k < m.pages; k++)
+			m.cdf[k] /= total;
+	}
+	else if (sscanf(spec.c_str(), "phases:%ld:%ld:%ld", &m.pages, &m.setSize, &m.phaseLength) == 3)
+	{
+		m.kind = PHASES;
+		if (m.setSize < 1 || m.setSize > m.pages || m.phaseLength < 1)
+			return false;
+	}
+	else if (sscanf(spec.c_str(), "scan:%ld", &m.pages) == 1)
+		m.kind = SCAN;
+	else if (sscanf(spec.c_str(), "loop:%ld:%ld:%ld", &m.pages, &m.length, &m.repeats) == 3)
+	{
+		/* A loop as long as its range, or run once, would be the same trace as scan */
+		m.kind = LOOP;
+		if (m.length < 1 || m.length >= m.pages || m.repeats < 2)
+			return false;
+	}
+	else
+		return false;
+	if (m.pages < 1)
+		return false;
+	m.base = models.empty() ? 0 : models.back().base + models.back().pages;
+	models.push_back(m);
+	return true;
+}
+
+/* Parses a model or a mixture of weighted models, returning false if it is malformed */
+bool ParseMixture(string spec)
+{
+	size_t start = 0;
+	while (start <= spec.size())
+	{
+		size_t end = spec.find('+', start);
+		string part = spec.substr(start, end == string::npos ? string::npos : end - start);
+		double weight = 1;
+		size_t star = part.find('*');
+		if (star != string::npos)
+		{
+			weight = atof(part.substr(0, star).c_str());
+			part = part.substr(star + 1);
+		}
+		if (weight <= 0 || !ParseModel(part, weight))
+			return false;
+		if (end == string::npos)
+			break;
+		start = end + 1;
+	}
+	return !models.empty();
+}
+
+/* Returns the page referenced at position i */
+long Reference(long i, Rng &rng)
+{
+	const Model *m = &models[0];
+	if (models.size() > 1)
+	{
+		/* The model of a burst depends only on the seed and the burst, not on the chunk */
+		double total = 0;
+		for (auto &other : models)
+			total += other.weight;
+		double pick = (Mix(seed ^ Mix(i / burst)) >> 11) * (1.0 / 9007199254740992.0) * total;
+		for (auto &other : models)
+		{
+			m = &other;
+			pick -= other.weight;
+			if (pick < 0)
+				break;
+		}
+	}
+
+	switch (m->kind)
+	{
+	case ZIPF:
+		return m->base + (upper_bound(m->cdf.begin(), m->cdf.end(), rng.uniform()) - m->cdf.begin()) % m->pages;
+	case PHASES:
+	{
+		long phase = i / m->phaseLength;
+		long start = Mix(seed ^ Mix(phase + 0x5EED)) % (m->pages - m->setSize + 1);
+		return m->base + start + rng.next() % m->setSize;
+	}
+	case SCAN:
+		return m->base + i % m->pages;
+	case LOOP:
+		return m->base + (i / (m->length * m->repeats) * m->length + i % m->length) % m->pages;
+	}
+	return 0;
+}
+
+/* Work for one thread: a chunk to generate into a text buffer */
+struct Job
+{
+	long chunk;
+	string text;
+};
+
+/* Appends n and a newline, or " w" and a newline for a write */
+void Append(string &text, long n, bool write)
+{
+	char digits[24];
+	int len = 0;
+	do
+	{
+		digits[len++] = '0' + n % 10;
+		n /= 10;
+	} while (n > 0);
+	while (len > 0)
+		text.push_back(digits[--len]);
+	if (write)
+		text.append(" w");
+	text.push_back('\n');
+}
+
+/* Thread method (generator). Param is the job to fill in */
+void *generate(void *param)
+{
+	Job *job = (Job *)param;
+	Rng rng = {Mix(seed ^ Mix(job->chunk)) | 1};
+	long first = job->chunk * CHUNK;
+	long last = min(references, first + CHUNK);
+	job->text.clear();
+	job->text.reserve((last - first) * 9);
+	for (long i = first; i < last; i++)
+	{
+		long page = Reference(i, rng);
+		Append(job->text, page, writeRatio > 0 && rng.uniform() < writeRatio);
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	string output;
+	int opt;
+	bool usage = false;
+	while ((opt = getopt(argc, argv, "s:j:b:w:o:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		case 'b':
+			burst = atol(optarg);
+			break;
+		case 'w':
+			writeRatio = atof(optarg);
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage = true;
+		}
+	}
+	if (usage || argc - optind != 2 || threads < 1 || burst < 1)
+	{
+		cout << "Usage: " << argv[0] << " [-s seed] [-j threads] [-b burst] [-w write ratio] [-o file] <references> <model>" << endl;
+		return -1;
+	}
+	references = atol(argv[optind]);
+	if (references < 0 || !ParseMixture(argv[optind + 1]))
+	{
+		cout << "ERROR: Bad model " << argv[optind + 1] << endl;
+		return -1;
+	}
+
+	FILE *out = output.empty() ? stdout : fopen(output.c_str(), "w");
+	if (out == NULL)
+	{
+		cout << "ERROR: Cannot open " << output << endl;
+		return -1;
+	}
+	fprintf(out, "%ld\n", references);
+
+	/* Generate threads chunks at a time, then write them out in order */
+	long chunks = (references + CHUNK - 1) / CHUNK;
+	vector<Job> jobs(threads);
+	vector<pthread_t> tid(threads);
+	for (long next = 0; next < chunks; next += threads)
+	{
+		int running = min<long>(threads, chunks - next);
+		for (int t = 0; t < running; t++)
+		{
+			jobs[t].chunk = next + t;
+			pthread_create(&tid[t], NULL, generate, &jobs[t]);
+		}
+		for (int t = 0; t < running; t++)
+		{
+			pthread_join(tid[t], NULL);
+			fwrite(jobs[t].text.data(), 1, jobs[t].text.size(), out);
+		}
+	}
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
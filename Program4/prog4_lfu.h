@@ -0,0 +1,118 @@
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+using namespace std;
+
+class PRDS_LFU
+{
+public:
+    // Sets the max number of pages in main memory. If aging is above 0, every aging references all
+    // use counts are halved, so a page that was hot long ago does not stay in memory forever.
+    PRDS_LFU(int pages, int aging = 0)
+    {
+        max = pages;
+        this->aging = aging;
+    }
+
+    // Least frequently used, ties broken by least recently used. Pages are grouped in buckets of equal
+    // use count, kept in order of count, so a hit moves a page to the next bucket and the victim is the
+    // first page of the first bucket. Hits, misses and evictions are all O(1).
+    // result == -1: Do not replace anything
+    //        >=  0: Replace the page in slot <result>
+    int replaceWith(int page)
+    {
+        if (aging > 0 && ++references % aging == 0)
+            age();
+
+        auto found = entries.find(page);
+        if (found != entries.end()) // Hit, the page moves up to the bucket of the next count
+        {
+            Entry &e = found->second;
+            auto next = bucketFor(e.bucket, e.bucket->count + 1);
+            next->pages.splice(next->pages.end(), e.bucket->pages, e.it);
+            if (e.bucket->pages.empty())
+                buckets.erase(e.bucket);
+            e.bucket = next;
+            return -1;
+        }
+
+        int slot;
+        if ((int)entries.size() < max) // If memory is not full, take the next empty slot
+        {
+            slot = entries.size();
+        }
+        else // Otherwise, replace the least recently used of the least frequently used pages
+        {
+            auto least = buckets.begin();
+            int victim = least->pages.front();
+            slot = entries[victim].slot;
+            entries.erase(victim);
+            least->pages.pop_front();
+            if (least->pages.empty())
+                buckets.erase(least);
+        }
+
+        auto first = buckets.begin() != buckets.end() && buckets.front().count == 1 ? buckets.begin() : buckets.insert(buckets.begin(), {1, {}});
+        first->pages.push_back(page);
+        entries[page] = {first, prev(first->pages.end()), slot};
+        return slot;
+    }
+
+private:
+    struct Bucket
+    {
+        int count;       // Use count of every page in the bucket
+        list<int> pages; // Least recently used at the front
+    };
+    struct Entry
+    {
+        list<Bucket>::iterator bucket; // Bucket the page is in
+        list<int>::iterator it;        // Position of the page in that bucket
+        int slot;                      // Index in the pages vector
+    };
+
+    int max;
+    int aging;                         // References between halving all use counts, 0 for never
+    long references = 0;               // References seen so far
+    list<Bucket> buckets;              // Buckets in increasing order of count, none empty
+    unordered_map<int, Entry> entries; // Every page in memory
+
+    // Returns the bucket for count, which is from or comes right after it, creating it if needed
+    list<Bucket>::iterator bucketFor(list<Bucket>::iterator from, int count)
+    {
+        auto next = std::next(from);
+        if (next != buckets.end() && next->count == count)
+            return next;
+        return buckets.insert(next, {count, {}});
+    }
+
+    // Halves every use count, keeping at least 1. Buckets that end up with the same count are
+    // merged, with the pages of the lower one counted as less recently used.
+    void age()
+    {
+        for (auto b = buckets.begin(); b != buckets.end();)
+        {
+            b->count = std::max(1, b->count / 2);
+            auto previous = b == buckets.begin() ? buckets.end() : prev(b);
+            if (previous != buckets.end() && previous->count == b->count)
+            {
+                for (int page : b->pages)
+                {
+                    entries[page].bucket = previous;
+                }
+                previous->pages.splice(previous->pages.end(), b->pages);
+                b = buckets.erase(b);
+            }
+            else
+            {
+                b++;
+            }
+        }
+    }
+};
+
+int Page_Replacement_LFU(vector<int> & /* pages */, int nextpage, PRDS_LFU *p)
+{
+    return p->replaceWith(nextpage); // The data structure already knows which slot each page is in
+}
\ No newline at end of file
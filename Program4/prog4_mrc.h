@@ -0,0 +1,159 @@
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+/*
+	Miss ratio curve of LRU for every memory size up to maxPages, from the stack distance of each
+	reference (the number of other pages used since the last use of the same page). With rate 1 the
+	curve is exact. With a lower rate only pages whose hashed id falls under the threshold are
+	followed (SHARDS), and their distances are scaled back up by 1 / rate.
+
+	If maxSamples is above 0, at most that many pages are followed. When one more turns up, the
+	page with the largest hash is dropped and the threshold falls to its hash, so memory stays
+	bounded however many pages the trace touches.
+*/
+class MRC_LRU
+{
+public:
+	MRC_LRU(int maxPages, double rate = 1.0, int maxSamples = 0)
+	{
+		this->maxPages = maxPages;
+		this->maxSamples = maxSamples;
+		threshold = rate >= 1.0 ? MODULUS : (uint64_t)(rate * MODULUS);
+		histogram = vector<double>(maxPages + 1, 0);
+		tree = vector<int>(1024 + 1, 0);
+	}
+
+	void access(int page)
+	{
+		references++;
+		uint64_t hash = Hash(page);
+		if (hash >= threshold)
+			return;
+		sampled++;
+		double rate = (double)threshold / MODULUS;
+
+		auto found = last.find(page);
+		if (found == last.end())
+		{
+			histogram[maxPages] += 1; // First use, a miss at every size
+			long t = stamp(page);
+			last[page] = t;
+			if (maxSamples > 0)
+			{
+				followed.insert(make_pair(hash, page));
+				if ((int)followed.size() > maxSamples)
+					shrink();
+			}
+			return;
+		}
+
+		/* Pages used since, counted by how many last uses come after this page's */
+		long distance = (long)((count(now) - count(found->second)) / rate);
+		histogram[min<long>(distance, maxPages)] += 1;
+		add(found->second, -1);
+		found->second = stamp(page);
+	}
+
+	// Returns the miss ratio for every memory size from 1 to maxPages, at index size - 1
+	vector<double> curve()
+	{
+		/* Sampled references that should have been seen at the final rate but were not are counted
+		   as hits at every size, which corrects for the sample holding too many or too few (SHARDS-adj) */
+		vector<double> h = histogram;
+		double expected = references * ((double)threshold / MODULUS);
+		h[0] += expected - sampled;
+		double total = max(expected, 1.0);
+
+		vector<double> ratios(maxPages);
+		double misses = h[maxPages];
+		for (int size = maxPages; size >= 1; size--)
+		{
+			ratios[size - 1] = min(1.0, max(0.0, misses / total));
+			misses += h[size - 1];
+		}
+		return ratios;
+	}
+
+	long followedPages() { return last.size(); }
+
+private:
+	static const uint64_t MODULUS = 1 << 24; // Hashes fall in [0, MODULUS)
+
+	int maxPages;
+	int maxSamples;                   // Pages followed at most, 0 for no limit
+	uint64_t threshold;               // Pages with a hash below this are followed
+	long references = 0;              // References in the trace so far
+	long sampled = 0;                 // References to followed pages so far
+	vector<double> histogram;         // References by scaled distance, distances of maxPages or more and first uses in the last one
+	unordered_map<int, long> last;    // Time stamp of the last use of every followed page
+	set<pair<uint64_t, int>> followed; // (hash, page) of every followed page, only kept when maxSamples is set
+	vector<int> tree;                 // Fenwick tree over time stamps, 1 where a followed page was last used
+	long now = 0;                     // Last time stamp handed out
+
+	static uint64_t Hash(int page)
+	{
+		uint64_t h = (uint64_t)(uint32_t)page * 0x9E3779B97F4A7C15ULL;
+		h ^= h >> 29;
+		h *= 0xBF58476D1CE4E5B9ULL;
+		h ^= h >> 32;
+		return h % MODULUS;
+	}
+
+	void add(long t, int delta)
+	{
+		for (; t < (long)tree.size(); t += t & -t)
+			tree[t] += delta;
+	}
+
+	long count(long t)
+	{
+		long total = 0;
+		for (; t > 0; t -= t & -t)
+			total += tree[t];
+		return total;
+	}
+
+	// Hands out the next time stamp and marks it as a last use. When the stamps run out, the
+	// followed pages are renumbered in order of last use, so the tree only ever needs room for
+	// twice the followed pages.
+	long stamp(int page)
+	{
+		if (now + 1 >= (long)tree.size())
+		{
+			vector<pair<long, int>> order;
+			for (auto &entry : last)
+			{
+				if (entry.first != page)
+					order.push_back(make_pair(entry.second, entry.first));
+			}
+			sort(order.begin(), order.end());
+			tree.assign(max<size_t>(1024, 2 * (order.size() + 1)) + 1, 0);
+			now = 0;
+			for (auto &entry : order)
+			{
+				last[entry.second] = ++now;
+				add(now, 1);
+			}
+		}
+		add(++now, 1);
+		return now;
+	}
+
+	// Drops the followed page with the largest hash, and every other with the same hash, lowering the threshold to it
+	void shrink()
+	{
+		threshold = prev(followed.end())->first;
+		while (!followed.empty() && prev(followed.end())->first >= threshold)
+		{
+			int page = prev(followed.end())->second;
+			add(last[page], -1);
+			last.erase(page);
+			followed.erase(prev(followed.end()));
+		}
+	}
+};
\ No newline at end of file
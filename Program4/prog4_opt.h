@@ -0,0 +1,128 @@
+#include <vector>
+#include <unordered_map>
+#include <climits>
+
+using namespace std;
+
+class PRDS_OPT
+{
+public:
+    // Belady's optimal (MIN) policy. Needs the whole trace up front, and must then be given its pages in order.
+    // One backward pass over the trace finds, for every reference, when the same page is used next.
+    // Prefetched pages may come in between, and are keyed by their first use from the next reference on.
+    PRDS_OPT(int pages, const vector<int> &trace)
+    {
+        max = pages;
+        this->trace = trace;
+        nextUse = vector<int>(trace.size());
+        unordered_map<int, int> seen; // Earliest later reference of each page seen so far
+        for (int i = trace.size() - 1; i >= 0; i--)
+        {
+            auto later = seen.find(trace[i]);
+            nextUse[i] = later == seen.end() ? INT_MAX : later->second;
+            seen[trace[i]] = i;
+        }
+        upcoming = seen;
+    }
+
+    // Takes in the next page as a parameter and returns the an integer to tell the page replacement function what to do.
+    // Resident pages are kept in a max-heap keyed by their next use, so each reference costs O(log pages).
+    // prefetch says the page is being brought in ahead of its use rather than referenced.
+    // result == -1: Do not replace anything
+    //        >=  0: Replace the page in slot <result>
+    int replaceWith(int page, bool prefetch = false)
+    {
+        if (!prefetch && now < trace.size() && trace[now] == page)
+            now++;
+        int next = firstUse(page);
+
+        auto resident = position.find(page);
+        if (resident != position.end()) // If the page is in memory, only its next use moves later
+        {
+            heap[resident->second].first = next;
+            siftUp(resident->second);
+            return -1;
+        }
+
+        int result;
+        if ((int)heap.size() < max) // If memory is not full, take the next empty slot
+        {
+            result = heap.size();
+            heap.push_back(make_pair(next, page));
+            position[page] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+        }
+        else // Otherwise, replace the page used furthest in the future, found at the top of the heap
+        {
+            int victim = heap[0].second;
+            result = slot[victim];
+            slot.erase(victim);
+            position.erase(victim);
+            heap[0] = make_pair(next, page);
+            position[page] = 0;
+            siftDown(0);
+        }
+        slot[page] = result;
+        return result;
+    }
+
+private:
+    int max;
+    size_t now = 0;                   // Index in the trace of the next reference
+    vector<int> trace;                // Pages in the order they will be given
+    vector<int> nextUse;              // Index of the next reference to the same page, INT_MAX if there is none
+    vector<pair<int, int>> heap;      // (next use, page) of every page in memory, largest next use on top
+    unordered_map<int, int> position; // Index in the heap of every page in memory
+    unordered_map<int, int> slot;     // Index in the pages vector of every page in memory
+    unordered_map<int, int> upcoming; // A reference to every page at or before its first use from now on
+
+    // Returns the index of the first reference to the page from now on, INT_MAX if there is none.
+    // now only moves forward, so following the nextUse chain costs O(1) per reference overall.
+    int firstUse(int page)
+    {
+        auto found = upcoming.find(page);
+        if (found == upcoming.end())
+            return INT_MAX;
+        while (found->second < (int)now)
+            found->second = nextUse[found->second];
+        return found->second;
+    }
+
+    void swapEntries(int i, int j)
+    {
+        swap(heap[i], heap[j]);
+        position[heap[i].second] = i;
+        position[heap[j].second] = j;
+    }
+
+    void siftUp(int i)
+    {
+        while (i > 0 && heap[(i - 1) / 2].first < heap[i].first)
+        {
+            swapEntries(i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+    }
+
+    void siftDown(int i)
+    {
+        while (true)
+        {
+            int largest = i;
+            for (int child = 2 * i + 1; child <= 2 * i + 2 && child < (int)heap.size(); child++)
+            {
+                if (heap[child].first > heap[largest].first)
+                    largest = child;
+            }
+            if (largest == i)
+                return;
+            swapEntries(i, largest);
+            i = largest;
+        }
+    }
+};
+
+int Page_Replacement_OPT(vector<int> & /* pages */, int nextpage, PRDS_OPT *p, bool prefetch = false)
+{
+    return p->replaceWith(nextpage, prefetch); // The data structure already knows which slot each page is in
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include <vector>
+#include <unordered_map>
+
+#include "prog4_frames.h"
+
+using namespace std;
+
+class PRDS_PFF
+{
+public:
+    PRDS_PFF(int interval) { this->interval = interval; } // Sets the fault interval, in references, above which memory shrinks
+
+    // Page fault frequency. Each fault adds a frame. If the last fault was more than interval references
+    // ago, faults are rare enough that every page not used since then is taken out as well. Hits and
+    // faults that only add a frame are O(1), a fault that shrinks memory is O(pages in memory).
+    // result == -1: Do not replace anything
+    //        >=  0: Put the page in slot <result>, after emptying the slots in frames.released
+    int replaceWith(int page)
+    {
+        frames.released.clear();
+        long time = now++;
+
+        auto found = lastUse.find(page);
+        if (found != lastUse.end()) // Hit
+        {
+            found->second = time;
+            return -1;
+        }
+
+        if (time - lastFault > interval) // Faults are rare, shrink to the pages used since the last fault
+        {
+            for (auto it = lastUse.begin(); it != lastUse.end();)
+            {
+                if (it->second < lastFault)
+                {
+                    frames.evict(it->first);
+                    it = lastUse.erase(it);
+                }
+                else
+                {
+                    it++;
+                }
+            }
+        }
+
+        lastFault = time;
+        lastUse[page] = time;
+        return frames.place(page);
+    }
+
+    int resident() { return frames.resident(); }
+
+    FrameTable frames;
+
+private:
+    int interval;
+    long now = 0;                     // Index in the trace of the next reference
+    long lastFault = 0;               // Time of the last fault
+    unordered_map<int, long> lastUse; // Time of the last use of every page in memory
+};
+
+int Page_Replacement_PFF(vector<int> &pages, int nextpage, PRDS_PFF *p)
+{
+    return Page_Replacement_Variable(pages, nextpage, p);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+/*
+	Prefetcher stage for the simulator. It is told about every miss, and every first use of a page
+	it brought in, and guesses up to degree pages that will be needed next:
+		next     the pages right after the one used (sequential read-ahead)
+		stride   the next pages at the same distance apart, once two triggers in a row were that far apart
+		history  the pages that followed this one the last time it triggered, one after the other
+*/
+class Prefetcher
+{
+public:
+	// kind is "next", "stride" or "history"
+	Prefetcher(string kind, int degree)
+	{
+		this->kind = kind;
+		this->degree = degree;
+	}
+
+	// Returns the pages to bring in after page triggered the prefetcher
+	vector<int> predict(int page)
+	{
+		vector<int> guesses;
+		if (kind == "next")
+		{
+			for (int k = 1; k <= degree; k++)
+				guesses.push_back(page + k);
+		}
+		else if (kind == "stride")
+		{
+			int stride = page - last;
+			if (stride != 0 && stride == lastStride)
+			{
+				for (int k = 1; k <= degree; k++)
+					guesses.push_back(page + k * stride);
+			}
+			lastStride = stride;
+		}
+		else if (kind == "history")
+		{
+			if (last != -1)
+				successor[last] = page;
+			int at = page;
+			for (int k = 0; k < degree; k++)
+			{
+				auto found = successor.find(at);
+				if (found == successor.end() || found->second == page)
+					break;
+				at = found->second;
+				guesses.push_back(at);
+			}
+		}
+		last = page;
+		return guesses;
+	}
+
+private:
+	string kind;
+	int degree;
+	int last = -1;					   // Page of the last trigger
+	int lastStride = 0;				   // Distance between the last two triggers, for stride
+	unordered_map<int, int> successor; // Page that triggered right after each page last time, for history
+};
\ No newline at end of file
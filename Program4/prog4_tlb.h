@@ -0,0 +1,93 @@
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+
+/*
+	Set-associative TLB sitting in front of the page replacement policies. A page maps to one set
+	by its hashed number, and a set holds up to ways translations, replaced by LRU, FIFO or at
+	random when full. When a page leaves memory its translation has to go as well (a shootdown).
+*/
+class TLB
+{
+public:
+	// entries is rounded down to a multiple of ways. replacement is "LRU", "FIFO" or "random".
+	TLB(int entries, int ways, string replacement)
+	{
+		this->ways = ways;
+		sets = max(1, entries / ways);
+		this->replacement = replacement;
+		tags = vector<int>(sets * ways, -1);
+		stamps = vector<long>(sets * ways, 0);
+	}
+
+	// Looks up the page, filling in its translation on a miss. Returns whether it hit.
+	bool lookup(int page)
+	{
+		now++;
+		int base = set(page) * ways;
+		int victim = base;
+		for (int i = base; i < base + ways; i++)
+		{
+			if (tags[i] == page)
+			{
+				hits++;
+				if (replacement == "LRU")
+					stamps[i] = now;
+				return true;
+			}
+			if (tags[victim] != -1 && (tags[i] == -1 || stamps[i] < stamps[victim]))
+				victim = i;
+		}
+
+		misses++;
+		if (replacement == "random" && tags[victim] != -1)
+			victim = base + (int)(next() % ways);
+		tags[victim] = page;
+		stamps[victim] = now;
+		return false;
+	}
+
+	// Drops the translation of a page that left memory
+	void shootdown(int page)
+	{
+		int base = set(page) * ways;
+		for (int i = base; i < base + ways; i++)
+		{
+			if (tags[i] == page)
+			{
+				tags[i] = -1;
+				shootdowns++;
+			}
+		}
+	}
+
+	long hits = 0;
+	long misses = 0;
+	long shootdowns = 0;
+
+private:
+	int sets;
+	int ways;
+	string replacement;
+	vector<int> tags;     // Page of every entry, -1 if empty, set after set
+	vector<long> stamps;  // Time each entry was filled, or last used under LRU
+	long now = 0;         // Lookups so far
+	uint64_t seed = 1;    // State of the generator for random replacement
+
+	int set(int page)
+	{
+		uint64_t h = (uint64_t)(uint32_t)page * 0x9E3779B97F4A7C15ULL;
+		return (int)((h >> 32) % sets);
+	}
+
+	uint64_t next()
+	{
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		return seed;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#include "prog4_frames.h"
+
+using namespace std;
+
+class PRDS_WS
+{
+public:
+    PRDS_WS(int window) { this->window = window; } // Sets the window, in references, that defines the working set
+
+    // Working set model. Memory holds exactly the pages used in the last window references, so a page
+    // leaves as soon as its last use falls out of the window, whether or not another page needs its slot.
+    // The window slides by one reference at a time, so each reference costs O(1) amortized.
+    // result == -1: Do not replace anything
+    //        >=  0: Put the page in slot <result>, after emptying the slots in frames.released
+    int replaceWith(int page)
+    {
+        frames.released.clear();
+        bool resident = last.count(page) > 0; // In the working set of the window up to the last reference
+        uses.push_back(make_pair(now, page));
+        last[page] = now++;
+
+        /* Uses that fall out of the window take their page out, unless it was used again since */
+        while (uses.front().first <= now - 1 - window)
+        {
+            auto expired = uses.front();
+            uses.pop_front();
+            if (last[expired.second] == expired.first)
+            {
+                last.erase(expired.second);
+                frames.evict(expired.second);
+            }
+        }
+
+        return resident ? -1 : frames.place(page);
+    }
+
+    int resident() { return frames.resident(); }
+
+    FrameTable frames;
+
+private:
+    int window;
+    long now = 0;                  // Index in the trace of the next reference
+    deque<pair<long, int>> uses;   // (time, page) of every reference in the window, oldest at the front
+    unordered_map<int, long> last; // Time of the last use of every page in the working set
+};
+
+int Page_Replacement_WS(vector<int> &pages, int nextpage, PRDS_WS *p)
+{
+    return Page_Replacement_Variable(pages, nextpage, p);
+}
\ No newline at end of file